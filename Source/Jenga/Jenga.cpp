@@ -1,6 +1,25 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "Jenga.h"
+#include "JengaStats.h"
 #include "Modules/ModuleManager.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Jenga, "Jenga" );
+
+DEFINE_LOG_CATEGORY(LogJenga);
+
+DEFINE_STAT(STAT_JengaGameModeTick);
+DEFINE_STAT(STAT_JengaNextRound);
+DEFINE_STAT(STAT_JengaApplyConfiguration);
+DEFINE_STAT(STAT_JengaGetConfiguration);
+DEFINE_STAT(STAT_JengaIsOnTop);
+DEFINE_STAT(STAT_JengaPredictStability);
+DEFINE_STAT(STAT_JengaFloorContact);
+DEFINE_STAT(STAT_JengaDrag);
+DEFINE_STAT(STAT_JengaDragSubstep);
+
+DEFINE_STAT(STAT_JengaBlocksScanned);
+DEFINE_STAT(STAT_JengaSnapshots);
+DEFINE_STAT(STAT_JengaFloorContacts);
+
+CSV_DEFINE_CATEGORY_MODULE(JENGA_API, Jenga, true);
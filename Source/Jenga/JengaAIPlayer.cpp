@@ -0,0 +1,247 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaAIPlayer.h"
+#include "Jenga.h"
+#include "JengaGameMode.h"
+#include "JengaTowerSession.h"
+#include "JengaPlayerController.h"
+
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "HAL/PlatformTime.h"
+#include "Async/Async.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
+
+
+// Each candidate pull is checked at this number of depths
+static const int32 PULL_STEPS = 4;
+
+// How far a block is pulled out of the tower, beyond its length
+static const float PULL_MARGIN = 5.f;
+
+// The block is grabbed this far from the end opposite to the pull direction
+static const float GRAB_INSET = 5.f;
+
+// A move whose turn doesn't end within this time is given up (and planned again)
+static const float TURN_TIMEOUT = 30.f;
+
+// With no move to play, the AI waits this long before planning again
+static const float BACK_OFF_TIME = 1.f;
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+AJengaAIPlayer::AJengaAIPlayer()
+{
+   PrimaryActorTick.bCanEverTick = true;
+   PrimaryActorTick.bStartWithTickEnabled = true;
+
+   session = nullptr;
+   controller = nullptr;
+   state = AIState::IDLE;
+   turnTime = 0.f;
+   turnAtStart = -1;
+   backOffTime = 0.f;
+   planningTopPlacement = FVector::ZeroVector;
+   planningStartSeconds = 0.0;
+   aiPlayers = 0;
+   aiTurnBudgetMs = 50.f;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Have computer players been requested?
+bool AJengaAIPlayer::IsRequested()
+{
+   int32 aiPlayers = GetDefault<AJengaAIPlayer>()->aiPlayers;
+   FParse::Value(FCommandLine::Get(), TEXT("JengaAIPlayers="), aiPlayers);
+   return aiPlayers > 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called when the game starts or when spawned
+void AJengaAIPlayer::BeginPlay()
+{
+   Super::BeginPlay();
+
+   FParse::Value(FCommandLine::Get(), TEXT("JengaAIPlayers="), this->aiPlayers);
+
+   AJengaGameMode* gameMode = Cast<AJengaGameMode>(GetWorld()->GetAuthGameMode());
+   this->controller = Cast<AJengaPlayerController>(GetWorld()->GetFirstPlayerController());
+   if (!gameMode || gameMode->GetSessions().Num() == 0 || !this->controller)
+   {
+      UE_LOG(LogJenga, Error, TEXT("AI: cannot find the Jenga game mode and player controller"));
+      SetActorTickEnabled(false);
+      return;
+   }
+
+   this->session = gameMode->GetSessions()[0];
+   this->planner.Configure(&this->session->GetStabilityAnalyzer(), UJengaTowerSession::GetBlockSizes(), PULL_STEPS);
+
+   UE_LOG(LogJenga, Display, TEXT("AI: playing the last %d seat(s), %.0f ms per turn on %d worker threads"),
+      this->aiPlayers, this->aiTurnBudgetMs, FTaskGraphInterface::Get().GetNumWorkerThreads());
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called when the game ends
+void AJengaAIPlayer::EndPlay(const EEndPlayReason::Type endPlayReason)
+{
+   // The workers use this actor's planner and candidates
+   if (this->planning.IsValid())
+      this->planning.Wait();
+
+   Super::EndPlay(endPlayReason);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called every frame
+void AJengaAIPlayer::Tick(float deltaTime)
+{
+   Super::Tick(deltaTime);
+
+   if (this->state == AIState::IDLE)
+   {
+      this->backOffTime -= deltaTime;
+      if (this->backOffTime <= 0.f && IsAITurn())
+         StartTurn();
+      return;
+   }
+
+   // Never wait for the workers: check again next frame
+   if (this->state == AIState::PLANNING)
+   {
+      if (this->planning.IsReady())
+         PlayBestMove();
+      return;
+   }
+
+   this->turnTime += deltaTime;
+   if (this->session->IsGameOver() || this->session->GetTurn() != this->turnAtStart || this->turnTime > TURN_TIMEOUT)
+      EndTurn();
+
+   else if (this->state == AIState::DRAGGING)
+   {
+      this->controller->DragTo(this->move.Evaluate(this->turnTime));
+      if (this->move.IsFinished(this->turnTime))
+      {
+         this->controller->ReleaseBlock();
+         this->state = AIState::SETTLING;
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Is it a computer player's turn?
+bool AJengaAIPlayer::IsAITurn()
+{
+   return !this->session->IsGameOver()
+      && !this->controller->IsDragging()
+      && this->session->GetCurrentPlayer() >= this->session->GetNumberOfPlayers() - this->aiPlayers;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Starts scoring the possible moves on worker threads
+void AJengaAIPlayer::StartTurn()
+{
+   const FJengaBlockRegistry& registry = this->session->GetBlockRegistry();
+
+   TArray<AActor*> interactiveBlocks;
+   this->session->GetInteractiveBlocks(interactiveBlocks);
+   TArray<int32> blocks;
+   for (const auto& jengaBlock : interactiveBlocks)
+      blocks.Add(registry.IndexOf(jengaBlock));
+   if (blocks.Num() == 0)
+   {
+      BackOff();
+      return;
+   }
+
+   // The tower doesn't move while the AI thinks: the workers score a copy of its poses
+   this->session->GetBlockPoses(this->planningPoses);
+   this->planningTopPlacement = this->session->GetTopPlacement();
+   FJengaMovePlanner::MakeCandidates(blocks, this->candidates);
+
+   this->turnAtStart = this->session->GetTurn();
+   this->planningStartSeconds = FPlatformTime::Seconds();
+   const double budgetSeconds = this->aiTurnBudgetMs / 1000.0;
+   this->planning = Async<int32>(EAsyncExecution::ThreadPool, [this, budgetSeconds]()
+   {
+      return this->planner.Evaluate(this->planningPoses, this->planningTopPlacement, this->candidates, budgetSeconds);
+   });
+   this->state = AIState::PLANNING;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Chooses the safest evaluated move and starts playing it
+void AJengaAIPlayer::PlayBestMove()
+{
+   const int32 evaluated = this->planning.Get();
+   this->planning = TFuture<int32>();
+   const double seconds = FPlatformTime::Seconds() - this->planningStartSeconds;
+   this->state = AIState::IDLE;
+
+   const int32 best = FJengaMovePlanner::FindBest(this->candidates);
+   UE_LOG(LogJenga, Display, TEXT("AI: %d/%d candidates evaluated in %.1f ms (%.0f candidates/s), best score %.2f"),
+      evaluated, this->candidates.Num(), seconds * 1000.0, evaluated / FMath::Max(seconds, 1e-6),
+      best != INDEX_NONE ? this->candidates[best].score : 0.f);
+
+   // The game went on meanwhile (e.g. an undo): plan again
+   if (this->session->GetTurn() != this->turnAtStart || !IsAITurn())
+      return;
+
+   if (best == INDEX_NONE)
+   {
+      BackOff();
+      return;
+   }
+
+   // Grab the block at the end opposite to the pull direction, so that it's pulled the chosen way
+   const FJengaBlockRegistry& registry = this->session->GetBlockRegistry();
+   const FVector& topPlacement = this->planningTopPlacement;
+   const FJengaMoveCandidate& candidate = this->candidates[best];
+   UStaticMeshComponent* mesh = registry.GetMesh(candidate.block);
+   const FVector& blockSizes = UJengaTowerSession::GetBlockSizes();
+   const FVector blockAxis = mesh->GetForwardVector();
+   const FVector pullDir = FVector(blockAxis.X, blockAxis.Y, 0.f).GetSafeNormal() * candidate.direction;
+   const FVector grabPoint = mesh->Bounds.Origin + pullDir * (blockSizes.X / 2.f - GRAB_INSET);
+
+   this->move = FJengaScriptedMove::PullAndPlace(
+      grabPoint,
+      blockAxis,
+      this->session->GetTowerCenter(),
+      blockSizes.X + PULL_MARGIN,
+      topPlacement + pullDir * (blockSizes.X / 2.f - GRAB_INSET),
+      2.f * blockSizes.Z
+   );
+
+   this->controller->SetScripted(true);
+   if (this->controller->PickBlock(mesh, grabPoint))
+   {
+      this->turnTime = 0.f;
+      this->state = AIState::DRAGGING;
+   }
+   else
+   {
+      this->controller->SetScripted(false);
+      BackOff();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Gives the controller back to the human players
+void AJengaAIPlayer::EndTurn()
+{
+   this->controller->ReleaseBlock();
+   this->controller->SetScripted(false);
+   this->state = AIState::IDLE;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Waits a while before trying to play again
+void AJengaAIPlayer::BackOff()
+{
+   UE_LOG(LogJenga, Verbose, TEXT("AI: no move to play, trying again in %.1f s"), BACK_OFF_TIME);
+   this->backOffTime = BACK_OFF_TIME;
+   this->state = AIState::IDLE;
+}
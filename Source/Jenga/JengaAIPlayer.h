@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Async/Future.h"
+#include "JengaMovePlanner.h"
+#include "JengaScriptedMove.h"
+#include "JengaAIPlayer.generated.h"
+
+class AJengaPlayerController;
+class UJengaTowerSession;
+
+/**
+* Plays the last seats of the player's tower (aiPlayers in DefaultGame.ini, or -JengaAIPlayers=N).
+* At each of its turns it scores every possible move on worker threads, within a time budget
+* (the game thread only polls for the result), and plays the safest one through the player
+* controller's pick/drag/release flow.
+*/
+UCLASS(Config=Game)
+class JENGA_API AJengaAIPlayer : public AActor
+{
+   GENERATED_BODY()
+
+public:
+   // Constructor
+   AJengaAIPlayer();
+
+   // Have computer players been requested?
+   static bool IsRequested();
+
+protected:
+   // Called when the game starts or when spawned
+   virtual void BeginPlay() override;
+
+   // Called when the game ends (waits for the move evaluation, if any)
+   virtual void EndPlay(const EEndPlayReason::Type endPlayReason) override;
+
+   // Called every frame
+   virtual void Tick(float deltaTime) override;
+
+private:
+   bool IsAITurn();
+   void StartTurn();
+   void PlayBestMove();
+   void EndTurn();
+   void BackOff();
+
+   UJengaTowerSession* session;
+   AJengaPlayerController* controller;
+   FJengaMovePlanner planner;
+
+   enum AIState { IDLE, PLANNING, DRAGGING, SETTLING };
+   AIState state;
+   FJengaScriptedMove move;
+   float turnTime;
+   int turnAtStart;
+
+   // Time left before trying to play again (after a turn with no move to play)
+   float backOffTime;
+
+   // Move evaluation on worker threads (they own the poses and candidates until it's done)
+   TFuture<int32> planning;
+   TArray<FTransform> planningPoses;
+   FVector planningTopPlacement;
+   TArray<FJengaMoveCandidate> candidates;
+   double planningStartSeconds;
+
+   // Number of seats (the last ones) played by the computer
+   UPROPERTY(Config) int32 aiPlayers;
+   // Time spent evaluating moves at every turn
+   UPROPERTY(Config) float aiTurnBudgetMs;
+};
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaBenchmarkResults.h"
+
+#include "Misc/FileHelper.h"
+
+
+static const TCHAR* const METRIC_NAMES[] = {
+   TEXT("frame"), TEXT("game_thread"), TEXT("physics"), TEXT("turn_latency")
+};
+
+
+///////////////////////////////////////////////////////////////////////////
+// Utility that returns a percentile of sorted samples (nearest rank)
+inline double percentile(const TArray<float>& sorted, double p)
+{
+   const int32 rank = FMath::CeilToInt(p * sorted.Num());
+   return sorted[FMath::Clamp(rank - 1, 0, sorted.Num() - 1)];
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Drops all the samples
+void FJengaBenchmarkResults::Reset()
+{
+   for (auto& metricSamples : this->samples)
+      metricSamples.Reset();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Adds a sample
+void FJengaBenchmarkResults::Add(Metric metric, double ms)
+{
+   this->samples[metric].Add((float)ms);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Summarizes the samples of a metric
+FJengaBenchmarkResults::FSummary FJengaBenchmarkResults::Summarize(Metric metric) const
+{
+   FSummary summary = { 0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+   if (this->samples[metric].Num() == 0)
+      return summary;
+
+   TArray<float> sorted = this->samples[metric];
+   sorted.Sort();
+
+   double sum = 0.0;
+   for (const float ms : sorted)
+      sum += ms;
+
+   summary.count = sorted.Num();
+   summary.average = sum / sorted.Num();
+   summary.p50 = percentile(sorted, 0.50);
+   summary.p95 = percentile(sorted, 0.95);
+   summary.p99 = percentile(sorted, 0.99);
+   summary.max = sorted.Last();
+   return summary;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Name of a metric (in logs and results files)
+const TCHAR* FJengaBenchmarkResults::GetName(Metric metric)
+{
+   return METRIC_NAMES[metric];
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Describes the metrics over budget
+bool FJengaBenchmarkResults::CheckBudgets(const FBudgets& budgets, TArray<FString>& outFailures) const
+{
+   outFailures.Reset();
+   for (int32 i = 0; i < METRICS_COUNT; i++)
+   {
+      const FSummary summary = Summarize((Metric)i);
+      if (budgets[i] > 0.f && summary.count > 0 && summary.p95 > budgets[i])
+         outFailures.Add(FString::Printf(TEXT("%s p95 %.3f ms > %.3f ms"), METRIC_NAMES[i], summary.p95, budgets[i]));
+   }
+   return outFailures.Num() == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Writes the results as JSON
+bool FJengaBenchmarkResults::Save(const FString& path, const FString& mapName, int32 seed, int32 turns, const FBudgets& budgets, bool passed) const
+{
+   FString json = FString::Printf(TEXT("{\n  \"map\": \"%s\",\n  \"seed\": %d,\n  \"turns\": %d,\n  \"passed\": %s,\n  \"metrics\": {\n"),
+      *mapName, seed, turns, passed ? TEXT("true") : TEXT("false"));
+
+   for (int32 i = 0; i < METRICS_COUNT; i++)
+   {
+      const FSummary summary = Summarize((Metric)i);
+      json += FString::Printf(
+         TEXT("    \"%s\": { \"count\": %d, \"avg\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"p99\": %.3f, \"max\": %.3f, \"budget_p95\": %.3f }%s\n"),
+         METRIC_NAMES[i], summary.count, summary.average, summary.p50, summary.p95, summary.p99, summary.max, budgets[i],
+         i + 1 < METRICS_COUNT ? TEXT(",") : TEXT(""));
+   }
+   json += TEXT("  }\n}\n");
+
+   return FFileHelper::SaveStringToFile(json, *path);
+}
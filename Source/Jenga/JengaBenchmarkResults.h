@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Timings collected by a gameplay benchmark (in milliseconds), one sample per frame
+* (or per turn for the turn latency). They are summarized into percentiles, checked
+* against the 95th percentile budgets and written to a JSON results file.
+*/
+class JENGA_API FJengaBenchmarkResults
+{
+public:
+   enum Metric { FRAME, GAME_THREAD, PHYSICS, TURN_LATENCY, METRICS_COUNT };
+
+   struct FSummary
+   {
+      int32 count;
+      double average, p50, p95, p99, max;
+   };
+
+   // Budgets of the 95th percentiles (0 means no budget)
+   typedef float FBudgets[METRICS_COUNT];
+
+   void Reset();
+   void Add(Metric metric, double ms);
+
+   FSummary Summarize(Metric metric) const;
+   static const TCHAR* GetName(Metric metric);
+
+   // Describes the metrics over budget (none means passed)
+   bool CheckBudgets(const FBudgets& budgets, TArray<FString>& outFailures) const;
+
+   // Writes the summaries, with the run's description and budgets
+   bool Save(const FString& path, const FString& mapName, int32 seed, int32 turns, const FBudgets& budgets, bool passed) const;
+
+private:
+   TArray<float> samples[METRICS_COUNT];
+};
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaBlockRegistry.h"
+
+#include "Engine/World.h"
+#include "Runtime/Engine/Classes/Kismet/GameplayStatics.h"
+#include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Collects all the blocks of the world (this is the only world scan!)
+void FJengaBlockRegistry::Register(UWorld* world, const FName& blockTag)
+{
+   TArray<AActor*> worldBlocks;
+   UGameplayStatics::GetAllActorsWithTag(world, blockTag, worldBlocks);
+
+   // Actors iteration order is not guaranteed: sorting by name gives each block the same index every time
+   worldBlocks.Sort([](const AActor& a, const AActor& b) { return a.GetName() < b.GetName(); });
+   Register(worldBlocks);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Registers the given blocks, in the given order
+void FJengaBlockRegistry::Register(const TArray<AActor*>& blocks)
+{
+   Reset();
+   this->blocks = blocks;
+
+   this->meshes.Reserve(this->blocks.Num());
+   this->indices.Reserve(this->blocks.Num());
+   for (int32 i = 0; i < this->blocks.Num(); i++)
+   {
+      this->meshes.Add(this->blocks[i]->FindComponentByClass<UStaticMeshComponent>());
+      this->indices.Add(this->blocks[i], i);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Forgets all the registered blocks
+void FJengaBlockRegistry::Reset()
+{
+   this->blocks.Reset();
+   this->meshes.Reset();
+   this->indices.Reset();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the StaticMeshComponent of a registered block
+UStaticMeshComponent* FJengaBlockRegistry::GetMesh(const AActor* block) const
+{
+   const int32* index = this->indices.Find(block);
+   return index ? this->meshes[*index] : nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the index of a block (INDEX_NONE if it's not a registered block)
+int32 FJengaBlockRegistry::IndexOf(const AActor* block) const
+{
+   const int32* index = this->indices.Find(block);
+   return index ? *index : INDEX_NONE;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the actual tower configuration
+TowerConfiguration FJengaBlockRegistry::GetConfiguration() const
+{
+   TowerConfiguration towerConfiguration;
+   towerConfiguration.Reserve(this->blocks.Num());
+   for (const auto& jengaBlock : this->blocks)
+      towerConfiguration.Add(jengaBlock->GetTransform());
+
+   return towerConfiguration;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Applies a given tower configuration
+void FJengaBlockRegistry::ApplyConfiguration(const TowerConfiguration& towerConf, bool atRest) const
+{
+   check(towerConf.Num() == this->blocks.Num());
+   for (int32 i = 0; i < this->blocks.Num(); i++)
+   {
+      UStaticMeshComponent* staticMesh = this->meshes[i];
+      if (atRest && !staticMesh->RigidBodyIsAwake() && towerConf[i].Equals(this->blocks[i]->GetActorTransform()))
+         continue;
+
+      // Teleport the body and stop its momentum (the body itself is kept)
+      this->blocks[i]->SetActorTransform(towerConf[i], false, nullptr, ETeleportType::TeleportPhysics);
+      if (FBodyInstance* body = staticMesh->GetBodyInstance())
+      {
+         body->SetLinearVelocity(FVector::ZeroVector, false);
+         body->SetAngularVelocityInRadians(FVector::ZeroVector, false);
+      }
+
+      if (atRest)
+         staticMesh->PutRigidBodyToSleep();
+      else
+         staticMesh->WakeRigidBody();
+   }
+}
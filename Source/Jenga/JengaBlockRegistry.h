@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class AActor;
+class UWorld;
+class UStaticMeshComponent;
+
+// A tower configuration is the list of the blocks' transforms, indexed by block id
+typedef TArray<FTransform> TowerConfiguration;
+
+/**
+* Keeps track of the jenga blocks, giving each one of them a stable index.
+* Blocks are collected once and then every snapshot/restore goes through here,
+* so that their cost depends on the tower and not on the whole world.
+*/
+class JENGA_API FJengaBlockRegistry
+{
+public:
+   // Collects all the actors with the given tag (sorted by name, so indices are stable)
+   void Register(UWorld* world, const FName& blockTag);
+   // Registers the given blocks, in the given order
+   void Register(const TArray<AActor*>& blocks);
+   void Reset();
+
+   // Blocks accessors
+   int32 Num() const { return blocks.Num(); }
+   AActor* GetBlock(int32 index) const { return blocks[index]; }
+   UStaticMeshComponent* GetMesh(int32 index) const { return meshes[index]; }
+   UStaticMeshComponent* GetMesh(const AActor* block) const;
+   int32 IndexOf(const AActor* block) const;
+   const TArray<AActor*>& GetBlocks() const { return blocks; }
+
+   // Snapshot and restore of the blocks' transforms. A restore teleports the blocks with no momentum,
+   // in a single pass: a tower restored at rest is put to sleep (and its sleeping blocks that
+   // didn't move are left untouched), otherwise every block is woken up
+   TowerConfiguration GetConfiguration() const;
+   void ApplyConfiguration(const TowerConfiguration& towerConf, bool atRest) const;
+
+private:
+   TArray<AActor*> blocks;
+   TArray<UStaticMeshComponent*> meshes;
+   TMap<const AActor*, int32> indices;
+};
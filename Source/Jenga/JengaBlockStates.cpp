@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaBlockStates.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Sets the number of blocks
+void FJengaBlockStates::Init(int32 nBlocks)
+{
+   for (auto& bits : this->states)
+      bits.Init(false, nBlocks);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets a state on all blocks
+void FJengaBlockStates::SetAll(State state, bool b)
+{
+   TBitArray<>& bits = this->states[state];
+   bits.SetRange(0, bits.Num(), b);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets a state on all blocks, as the opposite of another state
+void FJengaBlockStates::SetAllInverse(State state, State source)
+{
+   TBitArray<>& bits = this->states[state];
+   const TBitArray<>& sourceBits = this->states[source];
+   const int32 nWords = FMath::DivideAndRoundUp(bits.Num(), NumBitsPerDWORD);
+   for (int32 i = 0; i < nWords; i++)
+      bits.GetData()[i] = ~sourceBits.GetData()[i];
+
+   // Bits past the last block must stay cleared
+   if (bits.Num() % NumBitsPerDWORD != 0)
+      bits.GetData()[nWords - 1] &= (1u << (bits.Num() % NumBitsPerDWORD)) - 1;
+}
@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* The game state of every block of a tower, as one bit per block and per state
+* (indexed like the block registry), so that whole-tower updates touch a few words only.
+*/
+class JENGA_API FJengaBlockStates
+{
+public:
+   enum State { INTERACTIVE, PICKED, ON_FLOOR, TOP_LAYER, STATES_COUNT };
+
+   // Sets the number of blocks (all states cleared)
+   void Init(int32 nBlocks);
+
+   void Set(int32 index, State state, bool b) { states[state][index] = b; }
+   bool Get(int32 index, State state) const { return index != INDEX_NONE && states[state][index]; }
+
+   // Sets a state on all blocks
+   void SetAll(State state, bool b);
+
+   // Sets a state on all blocks, as the opposite of another state
+   void SetAllInverse(State state, State source);
+
+   // All the blocks' bits of a state
+   const TBitArray<>& GetAll(State state) const { return states[state]; }
+
+private:
+   TBitArray<> states[STATES_COUNT];
+};
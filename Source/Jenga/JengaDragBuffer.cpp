@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaDragBuffer.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaDragBuffer::FJengaDragBuffer()
+{
+   this->first = 0;
+   this->count = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Adds a sample
+void FJengaDragBuffer::Push(float time, const FVector& target)
+{
+   // Many samples in the same frame: keep the last one only
+   if (this->count > 0 && Get(this->count - 1).time >= time)
+   {
+      this->samples[(this->first + this->count - 1) % CAPACITY] = { time, target };
+      return;
+   }
+
+   if (this->count == CAPACITY)
+   {
+      this->first = (this->first + 1) % CAPACITY;
+      this->count--;
+   }
+   this->samples[(this->first + this->count) % CAPACITY] = { time, target };
+   this->count++;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Removes all the samples
+void FJengaDragBuffer::Reset()
+{
+   this->first = 0;
+   this->count = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the target at the given time
+FVector FJengaDragBuffer::Sample(float time) const
+{
+   if (this->count == 0)
+      return FVector::ZeroVector;
+   if (time <= Get(0).time)
+      return Get(0).target;
+
+   for (int32 i = 1; i < this->count; i++)
+   {
+      const FSample& next = Get(i);
+      if (time < next.time)
+      {
+         const FSample& prev = Get(i - 1);
+         const float alpha = (time - prev.time) / (next.time - prev.time);
+         return FMath::Lerp(prev.target, next.target, alpha);
+      }
+   }
+   return Get(this->count - 1).target;
+}
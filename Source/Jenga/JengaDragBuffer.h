@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* The last few drag targets, with the time they were sampled at.
+* Targets in between two samples are linearly interpolated.
+*/
+class JENGA_API FJengaDragBuffer
+{
+public:
+   FJengaDragBuffer();
+
+   // Adds a sample (older than the given time ones are overwritten when the buffer is full)
+   void Push(float time, const FVector& target);
+   void Reset();
+   bool IsEmpty() const { return count == 0; }
+
+   // Returns the target at the given time (clamped to the oldest/newest sample)
+   FVector Sample(float time) const;
+
+private:
+   static const int32 CAPACITY = 8;
+
+   struct FSample
+   {
+      float time;
+      FVector target;
+   };
+
+   const FSample& Get(int32 i) const { return samples[(first + i) % CAPACITY]; }
+
+   FSample samples[CAPACITY];
+   int32 first, count;
+};
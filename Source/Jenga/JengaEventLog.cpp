@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaEventLog.h"
+#include "Jenga.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/RunnableThread.h"
+#include "Serialization/Archive.h"
+
+
+// Events that can wait in the queue before being dropped
+static const uint32 QUEUE_CAPACITY = 4096;
+
+// How often the writer looks for new events (seconds)
+static const float WRITER_PERIOD = 0.05f;
+
+static const TCHAR* const EVENT_NAMES[] = {
+   TEXT("game_start"), TEXT("pick"), TEXT("release"), TEXT("turn"), TEXT("undo"), TEXT("redo"), TEXT("collapse"), TEXT("floor_hit"), TEXT("branch")
+};
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaEventLog::FJengaEventLog() : queue(QUEUE_CAPACITY)
+{
+   this->thread = nullptr;
+   this->startSeconds = 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Destructor
+FJengaEventLog::~FJengaEventLog()
+{
+   Close();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Starts writing a file
+bool FJengaEventLog::Open(const FString& path)
+{
+   Close();
+   this->file.Reset(IFileManager::Get().CreateFileWriter(*path));
+   if (!this->file)
+   {
+      UE_LOG(LogJenga, Error, TEXT("Event log: cannot write %s"), *path);
+      return false;
+   }
+
+   this->startSeconds = FPlatformTime::Seconds();
+   this->stopping = false;
+   this->dropped.Reset();
+   this->thread = FRunnableThread::Create(this, TEXT("JengaEventLog"), 0, TPri_BelowNormal);
+
+   UE_LOG(LogJenga, Display, TEXT("Event log: writing to %s"), *path);
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Stops writing (the queued events are written first)
+void FJengaEventLog::Close()
+{
+   if (!this->thread)
+      return;
+
+   this->thread->Kill(true);
+   delete this->thread;
+   this->thread = nullptr;
+
+   if (this->dropped.GetValue() > 0)
+      UE_LOG(LogJenga, Warning, TEXT("Event log: %d events dropped (queue full)"), this->dropped.GetValue());
+   this->file->Close();
+   this->file.Reset();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Queues an event
+void FJengaEventLog::Log(FJengaGameEvent::Type type, int32 tower, int32 turn, int32 player, int32 block, int32 nPlayers, uint64 hash)
+{
+   if (!this->thread)
+      return;
+
+   const FJengaGameEvent event = { type, FPlatformTime::Seconds() - this->startSeconds, tower, turn, player, block, nPlayers, hash };
+   if (!this->queue.Enqueue(event))
+      this->dropped.Increment();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Writer thread: drains the queue until stopped
+uint32 FJengaEventLog::Run()
+{
+   while (!this->stopping)
+   {
+      Drain();
+      FPlatformProcess::Sleep(WRITER_PERIOD);
+   }
+   Drain();
+   return 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Writes the queued events
+void FJengaEventLog::Drain()
+{
+   FJengaGameEvent event;
+   while (this->queue.Dequeue(event))
+   {
+      FString line = FString::Printf(TEXT("{\"t\":%.4f,\"event\":\"%s\",\"tower\":%d,\"turn\":%d,\"player\":%d"),
+         event.time, EVENT_NAMES[event.type], event.tower, event.turn, event.player);
+      if (event.block != INDEX_NONE)
+         line += FString::Printf(TEXT(",\"block\":%d"), event.block);
+      if (event.type == FJengaGameEvent::GAME_START)
+         line += FString::Printf(TEXT(",\"players\":%d"), event.nPlayers);
+      if (event.type == FJengaGameEvent::TURN)
+         line += FString::Printf(TEXT(",\"hash\":\"%016llx\""), event.hash);
+      line += TEXT("}\n");
+
+      FTCHARToUTF8 utf8(*line);
+      this->file->Serialize((void*)utf8.Get(), utf8.Length());
+   }
+}
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Containers/CircularQueue.h"
+
+class FArchive;
+class FRunnableThread;
+
+// A game event, as logged for match analytics
+struct FJengaGameEvent
+{
+   enum Type : uint8 { GAME_START, PICK, RELEASE, TURN, UNDO, REDO, COLLAPSE, FLOOR_HIT, BRANCH };
+
+   Type type;
+   double time;
+   int32 tower, turn, player;
+   int32 block;      // INDEX_NONE when the event has no block
+   int32 nPlayers;
+   uint64 hash;      // State hash (turn events only)
+};
+
+/**
+* Writes game events to a JSONL file (one JSON object per line).
+* The game thread only copies fixed-size records into a lock-free queue; a background
+* thread formats and writes them. Records are dropped (and counted) if the queue is full.
+*/
+class JENGA_API FJengaEventLog : public FRunnable
+{
+public:
+   FJengaEventLog();
+   ~FJengaEventLog();
+
+   // Starts/stops writing a file (stopping writes the queued events first)
+   bool Open(const FString& path);
+   void Close();
+   bool IsOpen() const { return thread != nullptr; }
+
+   // Game thread only: queues an event (timestamped with the seconds since the log was opened)
+   void Log(FJengaGameEvent::Type type, int32 tower, int32 turn, int32 player, int32 block = INDEX_NONE, int32 nPlayers = 0, uint64 hash = 0);
+
+   // FRunnable
+   virtual uint32 Run() override;
+   virtual void Stop() override { stopping = true; }
+
+private:
+   void Drain();
+
+   TCircularQueue<FJengaGameEvent> queue;
+   TUniquePtr<FArchive> file;
+   FRunnableThread* thread;
+   FThreadSafeBool stopping;
+   FThreadSafeCounter dropped;
+   double startSeconds;
+};
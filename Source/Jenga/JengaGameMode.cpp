@@ -1,39 +1,54 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "JengaGameMode.h"
+#include "Jenga.h"
+#include "JengaStats.h"
 #include "JengaPawn.h"
 #include "JengaPlayerController.h"
 #include "JengaHUD.h"
+#include "JengaTowerState.h"
+#include "JengaTowerSession.h"
+#include "JengaSimulationDriver.h"
+#include "JengaReplayDriver.h"
+#include "JengaScaleBenchmark.h"
+#include "JengaAIPlayer.h"
+#include "JengaTowerGenerator.h"
+#include "JengaSaveFile.h"
 
 #include "Engine/World.h"
 #include "EngineGlobals.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
 #include "Runtime/Engine/Classes/Engine/Engine.h"
+#include "Runtime/Engine/Classes/Engine/NetConnection.h"
+#include "GameFramework/PlayerState.h"
 #include "Runtime/Engine/Classes/Kismet/GameplayStatics.h"
 #include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
+#include "Runtime/Engine/Classes/Components/BoxComponent.h"
 #include "Runtime/Engine/Public/TimerManager.h"
 
 
 static const FName JENGA_BLOCK_TAG = "JengaBlock";
 static const FName JENGA_FLOOR_TAG = "JengaFloor";
-static const FName JENGA_INTERACTIVITY_TAG = "Interactive";
 
 static const int DEFAULT_NUMBER_OF_PLAYERS = 1;
 
-static const FVector BLOCK_SIZES = FVector(75.f, 25.f, 15.f);
-static const float BLOCKS_MAX_RANDOM_OFFSET = 0.8f;
-static const float BLOCKS_BALANCE_SPEED_THRESHOLD = 7.f;
+// Replays are recorded with this time resolution
+static const float REPLAY_STEP = 1.f / 60.f;
+
+// Height of the floors' trigger volumes (in block heights): less than a block, so that only the blocks lying on a floor touch it
+static const float FLOOR_TRIGGER_HEIGHT = 0.5f;
+
+// Bandwidth is logged this often (seconds)
+static const float NET_STATS_INTERVAL = 1.f;
 
 
 ///////////////////////////////////////////////////////////////////////////
 // Utility that finds the StaticMeshComponent of an actor
 inline UStaticMeshComponent* getMesh(AActor* actor)
 {
-   if (!actor)
-      return nullptr;
-
-   TArray<UStaticMeshComponent*> staticMeshes;
-   actor->GetComponents<UStaticMeshComponent>(staticMeshes);
-   return staticMeshes.Num() > 0 ? staticMeshes[0] : nullptr;
+   return actor ? actor->FindComponentByClass<UStaticMeshComponent>() : nullptr;
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -44,6 +59,19 @@ AJengaGameMode::AJengaGameMode()
    PlayerControllerClass = AJengaPlayerController::StaticClass();
    HUDClass = AJengaHUD::StaticClass();
 
+   historyChunkBlocks = 16;
+   historyBudgetKB = 0;
+   towersCount = 1;
+   towersSpacing = 500.f;
+   towerLayers = 0;
+   towerBlocksPerLayer = 3;
+   matchSeats = 2;
+   freezeSettledLayers = false;
+   showLoadHeatmap = false;
+   netStatsTime = 0.f;
+   netStatsRequested = false;
+   hashSteps = false;
+
    // Enable tick
    PrimaryActorTick.bStartWithTickEnabled = true;
    PrimaryActorTick.bCanEverTick = true;
@@ -55,291 +83,498 @@ void AJengaGameMode::BeginPlay()
 {
    GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Orange, TEXT("Welcome to Jenga!"));
 
-   // Get the array of blocks
-   UGameplayStatics::GetAllActorsWithTag(GetWorld(), JENGA_BLOCK_TAG, this->jengaBlocks);
-
-   // Save the initial blocks configuration
-   this->defaultConfiguration = GetActualTowerConfiguration();
-
-   // Register floor collision event
+   // Find the level's tower and floors (the only time we look for them in the world)
+   FJengaBlockRegistry levelBlocks;
+   levelBlocks.Register(GetWorld(), JENGA_BLOCK_TAG);
    TArray<AActor*> floors;
    UGameplayStatics::GetAllActorsWithTag(GetWorld(), JENGA_FLOOR_TAG, floors);
-   for (const auto& floor : floors)
-      getMesh(floor)->OnComponentHit.AddDynamic(this, &AJengaGameMode::OnFloorHit);
 
-   // Start a new game with the default number of players
-   NewGame(DEFAULT_NUMBER_OF_PLAYERS);
+   // Replace the level's tower with a generated one?
+   FParse::Value(FCommandLine::Get(), TEXT("JengaLayers="), this->towerLayers);
+   if (this->towerLayers > 0 && levelBlocks.Num() > 0)
+      GenerateTower(levelBlocks);
+
+   // Other towers (with their own floor) are copies of the level's one, laid out on a grid
+   FParse::Value(FCommandLine::Get(), TEXT("JengaTowers="), this->towersCount);
+   this->towersCount = FMath::Max(1, this->towersCount);
+   const int32 gridSize = FMath::CeilToInt(FMath::Sqrt((float)this->towersCount));
+   const int64 historyBudgetBytes = (int64)this->historyBudgetKB * 1024;
+   this->freezeSettledLayers |= FParse::Param(FCommandLine::Get(), TEXT("JengaFreezeLayers"));
+   this->showLoadHeatmap |= FParse::Param(FCommandLine::Get(), TEXT("JengaLoadHeatmap"));
+
+   TArray<AActor*> allFloors = floors;
+   for (int32 i = 0; i < this->towersCount; i++)
+   {
+      // The first tower is the level's one, the others only own their copies
+      TArray<AActor*> towerBlocks;
+      const FVector offset = FVector(i % gridSize, i / gridSize, 0.f) * this->towersSpacing;
+      if (i == 0)
+         towerBlocks = levelBlocks.GetBlocks();
+      else
+      {
+         SpawnCopies(levelBlocks.GetBlocks(), offset, towerBlocks);
+         SpawnCopies(floors, offset, allFloors);
+      }
+
+      UJengaTowerSession* session = NewObject<UJengaTowerSession>(this);
+      session->Init(towerBlocks, this->historyChunkBlocks, historyBudgetBytes, i == 0);
+      session->SetLayerFreezing(this->freezeSettledLayers);
+      session->SetLoadHeatmap(i == 0 && this->showLoadHeatmap);
+      this->sessions.Add(session);
+      this->sessionOffsets.Add(offset);
+      for (const auto& jengaBlock : towerBlocks)
+         this->blockSessions.Add(jengaBlock, session);
+
+      // Servers send each tower only to its match's players
+      if (GetNetMode() != NM_Standalone)
+      {
+         AJengaTowerState* towerState = GetWorld()->SpawnActor<AJengaTowerState>();
+         towerState->Init(session, offset);
+         this->towerStates.Add(towerState);
+      }
+   }
+
+   // Players who joined before the towers existed (e.g. the local one)
+   FParse::Value(FCommandLine::Get(), TEXT("JengaMatchSeats="), this->matchSeats);
+   this->matchSeats = FMath::Max(1, this->matchSeats);
+   for (FConstPlayerControllerIterator it = GetWorld()->GetPlayerControllerIterator(); it; ++it)
+      if (it->IsValid())
+         SeatPlayer(it->Get());
+
+   // Record the player's tower?
+   FString replayPath;
+   if (FParse::Value(FCommandLine::Get(), TEXT("JengaRecord="), replayPath) && this->recorder.Open(replayPath, this->sessions[0]->GetBlocks().Num(), REPLAY_STEP))
+      this->sessions[0]->SetRecorder(&this->recorder);
+
+   // Log the game events of every tower?
+   FString eventLogPath;
+   if (FParse::Value(FCommandLine::Get(), TEXT("JengaEventLog="), eventLogPath) && this->eventLog.Open(eventLogPath))
+      for (int32 i = 0; i < this->sessions.Num(); i++)
+         this->sessions[i]->SetEventLog(&this->eventLog, i);
+
+   // Trace the state of every tower (at every turn, or at every step), and compare it with a previous run?
+   FString hashTracePath, hashReferencePath;
+   FParse::Value(FCommandLine::Get(), TEXT("JengaHashTrace="), hashTracePath);
+   FParse::Value(FCommandLine::Get(), TEXT("JengaHashReference="), hashReferencePath);
+   this->hashSteps = FParse::Param(FCommandLine::Get(), TEXT("JengaHashSteps"));
+   if ((!hashTracePath.IsEmpty() || !hashReferencePath.IsEmpty()) && this->hashTrace.Open(hashTracePath, hashReferencePath))
+      for (int32 i = 0; i < this->sessions.Num(); i++)
+         this->sessions[i]->SetHashTrace(&this->hashTrace, i);
+
+   // Time the player's tower (shown by the HUD's performance overlay)
+   this->sessions[0]->SetPerfCounters(&this->perfCounters);
+   this->physicsTimer.Register(GetWorld(), &this->perfCounters);
+
+   // Start a new game with the default number of players (every game is seeded from the same stream)
+   int32 seed = FMath::Rand();
+   FParse::Value(FCommandLine::Get(), TEXT("JengaSeed="), seed);
+   this->random.Initialize(seed);
+   UE_LOG(LogJenga, Display, TEXT("Games seeded from %d"), seed);
+   for (const auto& session : this->sessions)
+      session->NewGame(DEFAULT_NUMBER_OF_PLAYERS, this->random.RandHelper(MAX_int32));
+
+   // Detect the blocks falling on the floors (the base blocks are already there, and ignored)
+   for (const auto& floor : allFloors)
+      AddFloorTrigger(floor);
+
+   if (this->towerStates.Num() > 0)
+      UE_LOG(LogJenga, Display, TEXT("Hosting %d match(es) of %d player(s)"), this->towersCount, this->matchSeats);
+   else if (this->towersCount > 1)
+      UE_LOG(LogJenga, Display, TEXT("Simulating %d towers"), this->towersCount);
+   this->netStatsRequested = FParse::Param(FCommandLine::Get(), TEXT("JengaNetStats"));
+
+   // Headless simulation, replay or benchmark requested from command line?
+   if (AJengaScaleBenchmark::IsRequested())
+      GetWorld()->SpawnActor<AJengaScaleBenchmark>();
+   else if (AJengaSimulationDriver::IsRequested())
+      GetWorld()->SpawnActor<AJengaSimulationDriver>();
+   else if (AJengaReplayDriver::IsRequested())
+      GetWorld()->SpawnActor<AJengaReplayDriver>();
+   else if (AJengaAIPlayer::IsRequested())
+      GetWorld()->SpawnActor<AJengaAIPlayer>();
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Resets the blocks positions and starts a new game
-void AJengaGameMode::NewGame(int nPlayers)
-{
-   // Init game parameters
-   this->turn = -1;
-   this->moves = 0;
-   this->nPlayers = nPlayers;
-   this->holdingPickedJengaBlock = false;
-   this->towerStatus = TowerStatus::BALANCED;
-
-   // Load the first (pinpoint accurate) tower configuration and clear the old ones
-   ApplyTowerConfiguration(this->defaultConfiguration);
-   this->oldConfigurations.Reset();
-
-   // Save those blocks touching the floor (they should be 3)
-   this->jengaBlocksOnFloor.Reset();
-   for (const auto& jengaBlock : this->jengaBlocks)
-      if (jengaBlock->GetTransform().GetLocation().Z == 0.0f)
-         this->jengaBlocksOnFloor.Add(jengaBlock);
-
-   // Apply a little randomness to blocks' positions (this stops the tower's jelly effect!)
-   for (const auto& jengaBlock : this->jengaBlocks)
+// Called when the game ends
+void AJengaGameMode::EndPlay(const EEndPlayReason::Type endPlayReason)
+{
+   if (this->sessions.Num() > 0)
    {
-      FTransform trx = jengaBlock->GetTransform();
-      trx.SetLocation(trx.GetLocation() + FVector(
-         FMath::RandRange(-BLOCKS_MAX_RANDOM_OFFSET, BLOCKS_MAX_RANDOM_OFFSET),
-         FMath::RandRange(-BLOCKS_MAX_RANDOM_OFFSET, BLOCKS_MAX_RANDOM_OFFSET),
-         FMath::RandRange(-BLOCKS_MAX_RANDOM_OFFSET, BLOCKS_MAX_RANDOM_OFFSET)
-      ));
-      jengaBlock->SetActorTransform(trx);
+      this->sessions[0]->SetRecorder(nullptr);
+      this->sessions[0]->SetPerfCounters(nullptr);
    }
-   this->gameConfiguration = GetActualTowerConfiguration();
-
-   // Game start message
-   const FString noOfPlayersString = FString::FromInt(this->nPlayers);
-   GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, "Starting a game with " + noOfPlayersString + " player(s)!");
+   for (const auto& session : this->sessions)
+   {
+      session->SetEventLog(nullptr, 0);
+      session->SetHashTrace(nullptr, 0);
+   }
+   this->recorder.Close();
+   this->eventLog.Close();
+   this->hashTrace.Close();
+   this->physicsTimer.Unregister();
 
-   // First player can move!
-   NextRound();
+   Super::EndPlay(endPlayReason);
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Called to lock current's player block to this one
-void AJengaGameMode::NewPick(AActor* block)
+// Replaces the level's tower with a generated one, built from its bottom blocks
+void AJengaGameMode::GenerateTower(FJengaBlockRegistry& levelBlocks)
 {
-   FString playerStr = "Player " + FString::FromInt(CurrentPlayer() + 1);
-   GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, playerStr + " picks " + block->GetName());
+   AActor* templateBlock = FJengaTowerGenerator::FindTemplate(levelBlocks.GetBlocks());
+   FVector towerCenter = FVector::ZeroVector;
+   for (int32 i = 0; i < levelBlocks.Num(); i++)
+      towerCenter += levelBlocks.GetMesh(i)->Bounds.Origin / levelBlocks.Num();
 
-   // Save the picked block
-   this->pickedJengaBlock = block;
-   this->holdingPickedJengaBlock = true;
-   this->jengaBlocksOnFloor.Remove(this->pickedJengaBlock);
+   const TowerConfiguration towerConf = FJengaTowerGenerator::MakeConfiguration(
+      templateBlock, towerCenter, this->towerLayers, FMath::Max(1, this->towerBlocksPerLayer), UJengaTowerSession::GetBlockSizes());
+   TArray<AActor*> towerBlocks;
+   FJengaTowerGenerator::Spawn(templateBlock, towerConf, towerBlocks);
 
-   // Block interactivity on all blocks
-   for (const auto& jengaBlock : this->jengaBlocks)
-      SetInteractive(jengaBlock, false);
+   for (const auto& jengaBlock : levelBlocks.GetBlocks())
+      jengaBlock->Destroy();
+   levelBlocks.Register(towerBlocks);
 
-   // Enable highlight and interactivity only on the picked one!
-   SetInteractive(this->pickedJengaBlock, true);
-   getMesh(this->pickedJengaBlock)->SetRenderCustomDepth(true);
+   UE_LOG(LogJenga, Display, TEXT("Generated a tower of %d layers (%d blocks)"), this->towerLayers, towerBlocks.Num());
+}
 
+///////////////////////////////////////////////////////////////////////////
+// Spawns a copy of the given actors, moved by the given offset
+void AJengaGameMode::SpawnCopies(const TArray<AActor*>& actors, const FVector& offset, TArray<AActor*>& outCopies)
+{
+   for (const auto& actor : actors)
+   {
+      FActorSpawnParameters params;
+      params.Template = actor;
+      FTransform trx = actor->GetTransform();
+      trx.AddToTranslation(offset);
+      outCopies.Add(GetWorld()->SpawnActor<AActor>(actor->GetClass(), trx, params));
+   }
 }
 
 ///////////////////////////////////////////////////////////////////////////
 // Called every frame
 void AJengaGameMode::Tick(float deltaTime)
 {
-   if (this->pickedJengaBlock && this->towerStatus != TowerStatus::COLLAPSED)
+   JENGA_SCOPE_CYCLE_COUNTER(STAT_JengaGameModeTick);
+
+   // All the towers step together
+   for (const auto& session : this->sessions)
+      session->Tick(deltaTime);
+
+   // Trace the state of every tower at every step (turns are traced by the towers)
+   if (this->hashTrace.IsOpen())
    {
-      // Estabilish the balance status of the tower
-      this->towerStatus = TowerStatus::BALANCED;
-      for (const auto& jengaBlock : this->jengaBlocks)
-      {
-         if (jengaBlock->GetVelocity().Size() > BLOCKS_BALANCE_SPEED_THRESHOLD)
-         {
-            this->towerStatus = TowerStatus::MOVING;
-            break;
-         }
-      }
+      this->hashTrace.Step();
+      if (this->hashSteps)
+         for (int32 i = 0; i < this->sessions.Num(); i++)
+            this->hashTrace.Record(FJengaHashTrace::STEP, i, this->sessions[i]->GetTurn(), this->sessions[i]->ComputeStateHash());
+   }
 
-      // Ok, the tower is balanced and the player has released the block...
-      if (this->towerStatus == TowerStatus::BALANCED && !this->holdingPickedJengaBlock)
-      {
-         // Estabilish if the move is good or not!
-         if (IsOnTop(this->pickedJengaBlock))
-            NextRound();
-      }
+   // Each match's players see their own tower
+   for (const auto& towerState : this->towerStates)
+      towerState->Update();
+   if (this->towerStates.Num() > 0)
+      LogNetStats(deltaTime);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Logs the bandwidth used by each remote player
+void AJengaGameMode::LogNetStats(float deltaTime)
+{
+   this->netStatsTime += deltaTime;
+   if (this->netStatsTime < NET_STATS_INTERVAL)
+      return;
+   this->netStatsTime = 0.f;
+
+   for (FConstPlayerControllerIterator it = GetWorld()->GetPlayerControllerIterator(); it; ++it)
+   {
+      const UNetConnection* connection = it->IsValid() ? (*it)->GetNetConnection() : nullptr;
+      const AJengaTowerState* towerState = connection ? GetPlayerTowerState(it->Get()) : nullptr;
+      if (!towerState || (*it)->IsLocalController())
+         continue;
+
+      const FString stats = FString::Printf(TEXT("Net: %s out %d B/s, in %d B/s (turn %d, tower %s)"),
+         *(*it)->GetName(), connection->OutBytesPerSecond, connection->InBytesPerSecond, towerState->GetTurn() + 1,
+         towerState->IsTowerMoving() ? TEXT("moving") : TEXT("at rest"));
+      if (this->netStatsRequested)
+         UE_LOG(LogJenga, Display, TEXT("%s"), *stats);
+      else
+         UE_LOG(LogJenga, Verbose, TEXT("%s"), *stats);
    }
 }
 
+///////////////////////////////////////////////////////////////////////////
+// Resets the blocks positions and starts a new game
+void AJengaGameMode::NewGame(const AController* player, int nPlayers)
+{
+   if (UJengaTowerSession* session = GetPlayerSession(player))
+      session->NewGame(nPlayers, this->random.RandHelper(MAX_int32));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called to lock current's player block to this one
+void AJengaGameMode::NewPick(AActor* block, const FVector& grabPoint)
+{
+   if (UJengaTowerSession* session = GetSession(block))
+      session->NewPick(block, grabPoint);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called when the player drags the picked block
+void AJengaGameMode::DragUpdated(AActor* block, const FVector& target)
+{
+   if (UJengaTowerSession* session = GetSession(block))
+      session->DragUpdated(block, target);
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Called when the player has released the picked block
 void AJengaGameMode::PickReleased(AActor* block)
 {
-   this->holdingPickedJengaBlock = false;
+   UJengaTowerSession* session = GetSession(block);
+   if (!session)
+      return;
+
+   // A block released while touching the floor won't start touching it again
+   session->PickReleased(block);
+   if (IsOnFloor(block))
+      session->OnFloorContact(block);
 }
 
 ///////////////////////////////////////////////////////////////////////////
 // Goes back to the previous round
-void AJengaGameMode::Undo()
+void AJengaGameMode::Undo(const AController* player)
 {
-   if (this->towerStatus != TowerStatus::BALANCED)
-      GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, "Cannot undo: Tower is not balanced!");
+   if (UJengaTowerSession* session = GetPlayerSession(player))
+      session->Undo();
+}
 
-   else if (this->holdingPickedJengaBlock)
-      GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, "Cannot undo: You are holding a block!");
+///////////////////////////////////////////////////////////////////////////
+// Restores a canceled round
+void AJengaGameMode::Redo(const AController* player)
+{
+   if (UJengaTowerSession* session = GetPlayerSession(player))
+      session->Redo();
+}
 
-   else if (this->turn < 1)
-      GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, "Cannot undo: This is the first turn!");
+///////////////////////////////////////////////////////////////////////////
+// Replays the current turn as it was played on another branch
+void AJengaGameMode::SwitchBranch(const AController* player, int32 branch)
+{
+   if (UJengaTowerSession* session = GetPlayerSession(player))
+      session->SwitchBranch(branch);
+}
 
-   else
-   {
-      this->turn-=2;
-      NextRound();
-   }
+///////////////////////////////////////////////////////////////////////////
+// Utility that returns the path of a saved game
+inline FString getSavePath(const FString& name)
+{
+   return FPaths::ProjectSavedDir() / TEXT("Jenga") / name + TEXT(".jsav");
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Restores a canceled round
-void AJengaGameMode::Redo()
+// Saves the player's tower game
+bool AJengaGameMode::SaveGame(const FString& name)
 {
-   if (this->towerStatus != TowerStatus::BALANCED)
-      GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, "Cannot redo: Tower is not balanced!");
+   FJengaSavedGame game;
+   this->sessions[0]->SaveGame(game);
+   const bool saved = FJengaSaveFile::Save(getSavePath(name), game);
 
-   else if (this->holdingPickedJengaBlock)
-      GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, "Cannot redo: You are holding a block!");
+   GEngine->AddOnScreenDebugMessage(-1, 5.f, saved ? FColor::Green : FColor::Red, (saved ? "Game saved: " : "Cannot save game: ") + name);
+   return saved;
+}
 
-   else if (this->turn + 1 > this->moves)
-      GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, "Cannot redo: No turns ahead!");
+///////////////////////////////////////////////////////////////////////////
+// Loads the player's tower game
+bool AJengaGameMode::LoadGame(const FString& name)
+{
+   FJengaSavedGame game;
+   const bool loaded = FJengaSaveFile::Load(getSavePath(name), game) && this->sessions[0]->LoadGame(game);
 
-   else
-      NextRound();
+   GEngine->AddOnScreenDebugMessage(-1, 5.f, loaded ? FColor::Green : FColor::Red, (loaded ? "Game loaded: " : "Cannot load game: ") + name);
+   return loaded;
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Increases the turn counter number and initializes the next round
-void AJengaGameMode::NextRound()
+// Shows/hides the removal risk heatmap on the player's tower
+void AJengaGameMode::ToggleLoadHeatmap()
 {
-   this->turn++;
-   this->moves = FMath::Max(this->turn, this->moves);
+   this->showLoadHeatmap = !this->sessions[0]->IsLoadHeatmapShown();
+   this->sessions[0]->SetLoadHeatmap(this->showLoadHeatmap);
+   GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, this->showLoadHeatmap ? TEXT("Load heatmap on") : TEXT("Load heatmap off"));
+}
 
-   // Show debug message
-   FString debugStr = "Turn " + FString::FromInt(this->turn + 1);
-   if (this->nPlayers > 1)
-      debugStr += ": Player " + FString::FromInt(CurrentPlayer() + 1) + " moves!";
-   GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, debugStr);
+///////////////////////////////////////////////////////////////////////////
+// Memory used by the undo/redo history of the player's tower
+int64 AJengaGameMode::GetHistoryMemoryUsage() const
+{
+   return this->sessions[0]->GetHistoryMemoryUsage();
+}
 
-   // Do we already had this turn? (because of undos/redos)
-   if (this->turn == -1)
-      ApplyTowerConfiguration(this->gameConfiguration);
-   else if (this->turn < this->oldConfigurations.Num())
-      ApplyTowerConfiguration(this->oldConfigurations[this->turn]);
-   else
-      this->oldConfigurations.Add(GetActualTowerConfiguration());
+///////////////////////////////////////////////////////////////////////////
+// Blocks of the player's tower simulated by physics right now
+int32 AJengaGameMode::GetAwakeBlocksCount() const
+{
+   return this->sessions[0]->GetAwakeBlocks().Num();
+}
 
-   // Make sure all blocks are interactive (except the top ones!)
-   for (const auto& jengaBlock : this->jengaBlocks)
-      SetInteractive(jengaBlock, !IsOnTop(jengaBlock));
+///////////////////////////////////////////////////////////////////////////
+// Returns the tower owning a block (if any)
+UJengaTowerSession* AJengaGameMode::GetSession(const AActor* jengaBlock) const
+{
+   UJengaTowerSession* const* session = this->blockSessions.Find(jengaBlock);
+   return session ? *session : nullptr;
+}
 
-   // Deactivate the previously picked block (if any)
-   if (this->pickedJengaBlock)
-   {
-      getMesh(this->pickedJengaBlock)->SetRenderCustomDepth(false);
-      this->pickedJengaBlock = nullptr;
-   }
+///////////////////////////////////////////////////////////////////////////
+// Can this block be picked?
+bool AJengaGameMode::IsInteractive(const AActor* jengaBlock) const
+{
+   const UJengaTowerSession* session = GetSession(jengaBlock);
+   return session && session->IsInteractive(jengaBlock);
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Game over event
-void AJengaGameMode::GameOver(FString msg)
+// Can this player pick a block now?
+bool AJengaGameMode::CanPlay(const AController* controller) const
 {
-   GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, msg);
-   FString playerStr = "Player " + FString::FromInt(CurrentPlayer() + 1);
-   GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, "Game over for " + playerStr + "!");
+   const FSeat* seat = this->seats.Find(controller);
+   if (!seat)
+      return false;
+
+   // A seat nobody took can be played by anyone in the match (e.g. local multiplayer)
+   const int32 currentPlayer = this->sessions[seat->match]->GetCurrentPlayer();
+   for (const auto& other : this->seats)
+      if (other.Value.match == seat->match && other.Value.seat == currentPlayer)
+         return other.Key == controller;
+   return true;
+}
 
-   // Deactivate the picked block
-   SetInteractive(this->pickedJengaBlock, false);
-   getMesh(this->pickedJengaBlock)->SetRenderCustomDepth(false);
+///////////////////////////////////////////////////////////////////////////
+// The match a player is seated in
+UJengaTowerSession* AJengaGameMode::GetPlayerSession(const AController* controller) const
+{
+   const FSeat* seat = this->seats.Find(controller);
+   return seat ? this->sessions[seat->match] : nullptr;
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Returns the index of the current player (0-based)
-int AJengaGameMode::CurrentPlayer()
+// What the players of a player's match receive
+AJengaTowerState* AJengaGameMode::GetPlayerTowerState(const AController* controller) const
 {
-   return (this->turn % this->nPlayers);
+   const FSeat* seat = this->seats.Find(controller);
+   return seat && this->towerStates.IsValidIndex(seat->match) ? this->towerStates[seat->match] : nullptr;
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Is this block on top of the tower?
-bool AJengaGameMode::IsOnTop(AActor* block)
+// Returns the block of a player's tower matching one of the level's blocks
+UPrimitiveComponent* AJengaGameMode::GetPlayerBlock(const AController* controller, const UPrimitiveComponent* levelBlock, FVector& outOffset) const
 {
-   // Find the height of the tower
-   float highestZ = -1.0f;
-   for (const auto& jengaBlock : this->jengaBlocks)
-      highestZ = FMath::Max(highestZ, jengaBlock->GetTransform().GetLocation().Z);
+   const FSeat* seat = this->seats.Find(controller);
+   const int32 index = levelBlock ? this->sessions[0]->GetBlockRegistry().IndexOf(levelBlock->GetOwner()) : INDEX_NONE;
+   if (!seat || index == INDEX_NONE)
+      return nullptr;
 
-   // Is the block on top?
-   float blockZ = block->GetTransform().GetLocation().Z;
-   return (highestZ - blockZ) < (BLOCK_SIZES[2] / 2.f);
+   outOffset = this->sessionOffsets[seat->match];
+   return this->sessions[seat->match]->GetBlockRegistry().GetMesh(index);
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Sets a block interactivity
-void AJengaGameMode::SetInteractive(AActor* jengaBlock, bool b)
+// A player joined
+void AJengaGameMode::PostLogin(APlayerController* newPlayer)
 {
-   if (b)
-   {
-      if (!IsInteractive(jengaBlock))
-         jengaBlock->Tags.Add(JENGA_INTERACTIVITY_TAG);
-   }
-   else
-      jengaBlock->Tags.Remove(JENGA_INTERACTIVITY_TAG);
+   Super::PostLogin(newPlayer);
+
+   // Before BeginPlay there are no towers yet: the player is seated later
+   if (this->sessions.Num() > 0)
+      SeatPlayer(newPlayer);
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Is this block interactive?
-bool AJengaGameMode::IsInteractive(AActor* jengaBlock)
+// A player left: the seat is free again
+void AJengaGameMode::Logout(AController* exiting)
 {
-   return jengaBlock->Tags.Contains(JENGA_INTERACTIVITY_TAG);
+   if (AJengaTowerState* towerState = GetPlayerTowerState(exiting))
+      towerState->RemovePlayer(exiting);
+   this->seats.Remove(exiting);
+
+   Super::Logout(exiting);
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Returns the actual tower configuration
-AJengaGameMode::TowerConfiguration AJengaGameMode::GetActualTowerConfiguration()
+// Gives a player a seat in the first match with a free one
+void AJengaGameMode::SeatPlayer(const AController* controller)
 {
-   TArray<AActor*> jengaBlocks;
-   UGameplayStatics::GetAllActorsWithTag(GetWorld(), JENGA_BLOCK_TAG, jengaBlocks);
+   if (this->seats.Contains(controller))
+      return;
 
-   TowerConfiguration towerConfiguration;
-   for (const auto& jengaBlock : jengaBlocks)
-      towerConfiguration.Add(jengaBlock->GetTransform());
+   // Taken seats of each match
+   TArray<TBitArray<>> taken;
+   taken.SetNum(this->sessions.Num());
+   for (auto& matchTaken : taken)
+      matchTaken.Init(false, this->matchSeats);
+   for (const auto& other : this->seats)
+      taken[other.Value.match][other.Value.seat] = true;
 
-   return towerConfiguration;
+   for (int32 match = 0; match < taken.Num(); match++)
+   {
+      const int32 seat = taken[match].Find(false);
+      if (seat == INDEX_NONE)
+         continue;
+
+      this->seats.Add(controller, { match, seat });
+      if (this->towerStates.IsValidIndex(match))
+         this->towerStates[match]->AddPlayer(controller);
+      UE_LOG(LogJenga, Display, TEXT("%s joins match %d as player %d"), *controller->GetName(), match + 1, seat + 1);
+      return;
+   }
+
+   UE_LOG(LogJenga, Warning, TEXT("%s cannot join: all the %d matches are full"), *controller->GetName(), taken.Num());
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Applies a given tower configuration
-void AJengaGameMode::ApplyTowerConfiguration(AJengaGameMode::TowerConfiguration towerConf)
+// Adds a trigger volume on top of a floor
+void AJengaGameMode::AddFloorTrigger(AActor* floor)
 {
-   TArray<AActor*> jengaBlocks;
-   UGameplayStatics::GetAllActorsWithTag(GetWorld(), JENGA_BLOCK_TAG, jengaBlocks);
-   for (int i = 0; i < jengaBlocks.Num(); i++)
-   {
-      // Apply the transform
-      jengaBlocks[i]->SetActorTransform(towerConf[i]);
+   UStaticMeshComponent* floorMesh = getMesh(floor);
+   floorMesh->SetNotifyRigidBodyCollision(false);
+
+   // A thin box on the floor's top face: only the blocks lying on the floor touch it
+   const FBox bounds = floorMesh->Bounds.GetBox();
+   const float height = FLOOR_TRIGGER_HEIGHT * UJengaTowerSession::GetBlockSizes().Z;
+   UBoxComponent* trigger = NewObject<UBoxComponent>(floor);
+   trigger->SetBoxExtent(FVector(bounds.GetExtent().X, bounds.GetExtent().Y, 0.5f * height));
+   trigger->SetWorldLocation(FVector(bounds.GetCenter().X, bounds.GetCenter().Y, bounds.Max.Z + 0.5f * height));
+   trigger->SetCollisionProfileName(TEXT("OverlapAllDynamic"));
+   trigger->OnComponentBeginOverlap.AddDynamic(this, &AJengaGameMode::OnFloorOverlap);
+   trigger->RegisterComponent();
+   this->floorTriggers.Add(trigger);
+}
 
-      // Little trick to stop blocks' momentum
-      UStaticMeshComponent* staticMesh = getMesh(jengaBlocks[i]);
-      staticMesh->SetSimulatePhysics(false);
-      staticMesh->SetSimulatePhysics(true);
-   }
+///////////////////////////////////////////////////////////////////////////
+// Is this block touching a floor?
+bool AJengaGameMode::IsOnFloor(AActor* jengaBlock) const
+{
+   const UStaticMeshComponent* mesh = getMesh(jengaBlock);
+   for (const auto& trigger : this->floorTriggers)
+      if (mesh->IsOverlappingComponent(trigger))
+         return true;
+   return false;
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Collision event on the floor
-void AJengaGameMode::OnFloorHit(
-   UPrimitiveComponent* hitComponent,
+// A block started touching a floor
+void AJengaGameMode::OnFloorOverlap(
+   UPrimitiveComponent* overlappedComponent,
    AActor* otherActor,
    UPrimitiveComponent* otherComponent,
-   FVector normalImpulse,
-   const FHitResult& hit)
+   int32 otherBodyIndex,
+   bool fromSweep,
+   const FHitResult& sweepResult)
 {
-   // Ignore blocks already on floor
-   if (jengaBlocksOnFloor.Contains(otherActor) || (otherActor == pickedJengaBlock && holdingPickedJengaBlock))
-      return;
-   else if (this->towerStatus != TowerStatus::COLLAPSED)
-   {
-      this->towerStatus = TowerStatus::COLLAPSED;
-      GameOver("Tower collapsed!");
-   }
+   JENGA_SCOPE_CYCLE_COUNTER(STAT_JengaFloorContact);
+   JENGA_INC_COUNTER(STAT_JengaFloorContacts, 1);
+
+   if (UJengaTowerSession* session = GetSession(otherActor))
+      session->OnFloorContact(otherActor);
 }
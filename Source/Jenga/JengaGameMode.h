@@ -4,14 +4,23 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "JengaReplay.h"
+#include "JengaPerfCounters.h"
+#include "JengaEventLog.h"
+#include "JengaHashTrace.h"
 #include "JengaGameMode.generated.h"
 
 class AActor;
+class UPrimitiveComponent;
+class UBoxComponent;
+class UJengaTowerSession;
+class AJengaTowerState;
+class FJengaBlockRegistry;
 
 /**
 *
 */
-UCLASS()
+UCLASS(Config=Game)
 class JENGA_API AJengaGameMode : public AGameModeBase
 {
    GENERATED_BODY()
@@ -20,51 +29,141 @@ public:
    // Constructor
    AJengaGameMode();
 
-   // Starts a new game
-   void NewGame(int nPlayers);
+   // Starts a new game (on the player's tower)
+   void NewGame(const AController* player, int nPlayers);
 
-   void NewPick(AActor* jengaBlock);
+   // Pick events, routed to the tower owning the block
+   void NewPick(AActor* jengaBlock, const FVector& grabPoint);
+   void DragUpdated(AActor* jengaBlock, const FVector& target);
    void PickReleased(AActor* jengaBlock);
 
-   void Undo();
-   void Redo();
+   // Undo/redo (on the player's tower)
+   void Undo(const AController* player);
+   void Redo(const AController* player);
+   void SwitchBranch(const AController* player, int32 branch);
+
+   // Saves/loads the player's tower game (in Saved/Jenga/<name>.jsav)
+   bool SaveGame(const FString& name);
+   bool LoadGame(const FString& name);
+
+   // Shows/hides the removal risk heatmap on the player's tower
+   void ToggleLoadHeatmap();
+
+   // Memory used by the undo/redo history of the player's tower
+   int64 GetHistoryMemoryUsage() const;
+
+   // Blocks of the player's tower simulated by physics right now
+   int32 GetAwakeBlocksCount() const;
+
+   // Timings of the player's tower and of the physics step
+   FJengaPerfCounters& GetPerfCounters() { return perfCounters; }
+
+   // Towers hosted in this world (the first one is the player's tower)
+   const TArray<UJengaTowerSession*>& GetSessions() const { return sessions; }
+   UJengaTowerSession* GetSession(const AActor* jengaBlock) const;
+
+   // Can this block be picked? (asked to the tower owning it)
+   bool IsInteractive(const AActor* jengaBlock) const;
+
+   // Can this player pick a block now? (in networked games, each player has its own seat)
+   bool CanPlay(const AController* controller) const;
+
+   // The match a player is seated in (nullptr for spectators and scripted controllers)
+   UJengaTowerSession* GetPlayerSession(const AController* controller) const;
+   AJengaTowerState* GetPlayerTowerState(const AController* controller) const;
+
+   // Remote players pick the level's blocks: returns the same block of their own tower,
+   // and how far their tower is from the level's one
+   UPrimitiveComponent* GetPlayerBlock(const AController* controller, const UPrimitiveComponent* levelBlock, FVector& outOffset) const;
+
+   // Players joining/leaving the server
+   virtual void PostLogin(APlayerController* newPlayer) override;
+   virtual void Logout(AController* exiting) override;
 
 protected:
    // Called when the game starts or when spawned
    virtual void BeginPlay() override;
+   virtual void EndPlay(const EEndPlayReason::Type endPlayReason) override;
    virtual void Tick(float deltaTime) override;
 
-   void NextRound();
-   void GameOver(FString msg);
-   int CurrentPlayer();
-   bool IsOnTop(AActor* jengaBlock);
+   // Logs the bandwidth used by each remote player (Verbose, or Display with -JengaNetStats)
+   void LogNetStats(float deltaTime);
+
+   // Replaces the level's tower with a generated one (-JengaLayers=N)
+   void GenerateTower(FJengaBlockRegistry& levelBlocks);
+
+   // Gives a player a seat in the first match with a free one
+   void SeatPlayer(const AController* controller);
 
-   void SetInteractive(AActor* jengaBlock, bool b);
-   bool IsInteractive(AActor* jengaBlock);
+   // Spawns a copy of the given actors, moved by the given offset
+   void SpawnCopies(const TArray<AActor*>& actors, const FVector& offset, TArray<AActor*>& outCopies);
 
-   typedef TArray<FTransform> TowerConfiguration;
-   TowerConfiguration GetActualTowerConfiguration();
-   void ApplyTowerConfiguration(TowerConfiguration towerConf);
+   // Adds a trigger volume on top of a floor, reporting the blocks that start touching it
+   void AddFloorTrigger(AActor* floor);
+   bool IsOnFloor(AActor* jengaBlock) const;
 
-   UFUNCTION() void OnFloorHit(
-      UPrimitiveComponent* hitComponent,
+   UFUNCTION() void OnFloorOverlap(
+      UPrimitiveComponent* overlappedComponent,
       AActor* otherActor,
       UPrimitiveComponent* otherComponent,
-      FVector normalImpulse,
-      const FHitResult& hit
+      int32 otherBodyIndex,
+      bool fromSweep,
+      const FHitResult& sweepResult
    );
 
 private:
-   TArray<AActor*> jengaBlocks;
-   TowerConfiguration defaultConfiguration, gameConfiguration;
-   TArray<TowerConfiguration> oldConfigurations;
-
-   int turn, moves;
-   int nPlayers;
-   TSet<AActor*> jengaBlocksOnFloor;
-
-   AActor* pickedJengaBlock;
-   bool holdingPickedJengaBlock;
-   enum TowerStatus { BALANCED, MOVING, COLLAPSED };
-   TowerStatus towerStatus;
+   UPROPERTY() TArray<UJengaTowerSession*> sessions;
+   TMap<const AActor*, UJengaTowerSession*> blockSessions;
+   TArray<FVector> sessionOffsets;
+   UPROPERTY() TArray<UBoxComponent*> floorTriggers;
+
+   // Networked games: what each match's players receive, and where each player sits
+   struct FSeat
+   {
+      int32 match;
+      int32 seat;
+   };
+   UPROPERTY() TArray<AJengaTowerState*> towerStates;
+   TMap<const AController*, FSeat> seats;
+
+   // Records the player's tower games (-JengaRecord=<file>)
+   FJengaReplayRecorder recorder;
+
+   // Logs the game events of every tower (-JengaEventLog=<file>)
+   FJengaEventLog eventLog;
+
+   // Traces the state hash of every tower (-JengaHashTrace=<file>), compared with a previous run's (-JengaHashReference=<file>)
+   FJengaHashTrace hashTrace;
+   bool hashSteps;
+
+   // Seeds every new game (-JengaSeed=N makes the runs repeatable)
+   FRandomStream random;
+
+   FJengaPerfCounters perfCounters;
+   FJengaPhysicsTimer physicsTimer;
+
+   float netStatsTime;
+   bool netStatsRequested;
+
+   // Blocks per chunk of the undo/redo history (turns share the chunks where no block moved)
+   UPROPERTY(Config) int32 historyChunkBlocks;
+   // Max memory used by the undo/redo history (0 means unlimited)
+   UPROPERTY(Config) int32 historyBudgetKB;
+
+   // Number of towers simulated together (overridden by -JengaTowers=N) and the distance between them
+   UPROPERTY(Config) int32 towersCount;
+   UPROPERTY(Config) float towersSpacing;
+
+   // Number of layers of a generated tower (overridden by -JengaLayers=N), 0 to play the level's tower
+   UPROPERTY(Config) int32 towerLayers;
+   UPROPERTY(Config) int32 towerBlocksPerLayer;
+
+   // Freeze the settled bottom layers of the towers (overridden by -JengaFreezeLayers)
+   UPROPERTY(Config) bool freezeSettledLayers;
+
+   // Highlight the player's tower blocks by removal risk (overridden by -JengaLoadHeatmap)
+   UPROPERTY(Config) bool showLoadHeatmap;
+
+   // Players of each match hosted by a server (overridden by -JengaMatchSeats=N)
+   UPROPERTY(Config) int32 matchSeats;
 };
@@ -1,18 +1,29 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "JengaHUD.h"
+#include "JengaPlayerController.h"
 #include "JengaGameMode.h"
+#include "JengaPerfCounters.h"
 
 #include "Runtime/CoreUObject/Public/UObject/ConstructorHelpers.h"
 #include "Runtime/UMG/Public/Blueprint/UserWidget.h"
 #include "Runtime/UMG/Public/Components/Button.h"
 #include "Runtime/UMG/Public/Components/TextBlock.h"
+#include "Runtime/UMG/Public/Components/CanvasPanel.h"
+#include "Runtime/UMG/Public/Components/CanvasPanelSlot.h"
+#include "Runtime/UMG/Public/Blueprint/WidgetTree.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
 #include "Runtime/Engine/Classes/Engine/Engine.h"
 #include "Runtime/Engine/Classes/Kismet/GameplayStatics.h"
 
 const int MIN_NO_OF_PLAYERS = 1;
 const int MAX_NO_OF_PLAYERS = 100;
 
+// The performance overlay is refreshed this often (seconds)
+const float PERF_OVERLAY_INTERVAL = 0.5f;
+const FName PERF_OVERLAY_NAME = "PerfOverlay";
+
 ///////////////////////////////////////////////////////////////////////////
 // Constructor
 AJengaHUD::AJengaHUD()
@@ -21,6 +32,14 @@ AJengaHUD::AJengaHUD()
    // Yeah i know, it's not nice to hardcode the widget's reference...
    static ConstructorHelpers::FClassFinder<UUserWidget> widgetFinder(TEXT("/Game/Jenga/HUD/JengaHUD_BP"));
    hudWidgetClass = widgetFinder.Succeeded() ? widgetFinder.Class : nullptr;
+   hudWidget = nullptr;
+   playersNoMinusButton = playersNoPlusButton = nullptr;
+   playersNoText = perfOverlayText = nullptr;
+   noOfPlayers = MIN_NO_OF_PLAYERS;
+   showPerfOverlay = false;
+   perfOverlayTime = 0.f;
+
+   PrimaryActorTick.bCanEverTick = true;
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -39,13 +58,47 @@ void AJengaHUD::BeginPlay()
    hudWidget = CreateWidget<UUserWidget>(this->GetOwningPlayerController(), this->hudWidgetClass);
    hudWidget->AddToViewport();
 
-   getButton("PlayersNoMinusButton")->OnClicked.AddDynamic(this, &AJengaHUD::RemoveOnePlayer);
-   getButton("PlayersNoPlusButton")->OnClicked.AddDynamic(this, &AJengaHUD::AddOnePlayer);
+   this->playersNoMinusButton = getButton("PlayersNoMinusButton");
+   this->playersNoPlusButton = getButton("PlayersNoPlusButton");
+   this->playersNoText = getText("PlayersNo");
+
+   this->playersNoMinusButton->OnClicked.AddDynamic(this, &AJengaHUD::RemoveOnePlayer);
+   this->playersNoPlusButton->OnClicked.AddDynamic(this, &AJengaHUD::AddOnePlayer);
    getButton("RestartButton")->OnClicked.AddDynamic(this, &AJengaHUD::Restart);
    getButton("UndoButton")->OnClicked.AddDynamic(this, &AJengaHUD::Undo);
    getButton("RedoButton")->OnClicked.AddDynamic(this, &AJengaHUD::Redo);
 
    this->setNoOfPlayers(MIN_NO_OF_PLAYERS);
+
+   this->showPerfOverlay |= FParse::Param(FCommandLine::Get(), TEXT("JengaPerfOverlay"));
+   if (this->showPerfOverlay)
+      createPerfOverlay();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called every frame
+void AJengaHUD::Tick(float deltaTime)
+{
+   Super::Tick(deltaTime);
+
+   // The counters are aggregated by the game: the text is only rebuilt a few times per second
+   this->perfOverlayTime += deltaTime;
+   if (this->showPerfOverlay && this->perfOverlayText && this->perfOverlayTime >= PERF_OVERLAY_INTERVAL)
+   {
+      this->perfOverlayTime = 0.f;
+      updatePerfOverlay();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Console command that shows/hides the performance overlay
+void AJengaHUD::JengaPerfOverlay()
+{
+   this->showPerfOverlay = !this->showPerfOverlay;
+   if (this->showPerfOverlay && !this->perfOverlayText)
+      createPerfOverlay();
+   if (this->perfOverlayText)
+      this->perfOverlayText->SetVisibility(this->showPerfOverlay ? ESlateVisibility::HitTestInvisible : ESlateVisibility::Collapsed);
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -66,24 +119,24 @@ void AJengaHUD::RemoveOnePlayer()
 // Restarts the game
 void AJengaHUD::Restart()
 {
-   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
-   gameMode->NewGame(this->noOfPlayers);
+   AJengaPlayerController* controller = (AJengaPlayerController*)GetOwningPlayerController();
+   controller->RequestNewGame(this->noOfPlayers);
 }
 
 ///////////////////////////////////////////////////////////////////////////
 // Undo last action
 void AJengaHUD::Undo()
 {
-   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
-   gameMode->Undo();
+   AJengaPlayerController* controller = (AJengaPlayerController*)GetOwningPlayerController();
+   controller->RequestUndo();
 }
 
 ///////////////////////////////////////////////////////////////////////////
 // Redo last action
 void AJengaHUD::Redo()
 {
-   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
-   gameMode->Redo();
+   AJengaPlayerController* controller = (AJengaPlayerController*)GetOwningPlayerController();
+   controller->RequestRedo();
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -94,9 +147,62 @@ void AJengaHUD::setNoOfPlayers(int n)
    const FString noOfPlayersString = FString::FromInt(this->noOfPlayers);
    //GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Yellow, "New number of players: " + noOfPlayersString);
 
-   getButton("PlayersNoMinusButton")->SetIsEnabled(this->noOfPlayers > MIN_NO_OF_PLAYERS);
-   getButton("PlayersNoPlusButton")->SetIsEnabled(this->noOfPlayers < MAX_NO_OF_PLAYERS);
-   getText("PlayersNo")->SetText(FText::FromString(noOfPlayersString));
+   this->playersNoMinusButton->SetIsEnabled(this->noOfPlayers > MIN_NO_OF_PLAYERS);
+   this->playersNoPlusButton->SetIsEnabled(this->noOfPlayers < MAX_NO_OF_PLAYERS);
+   this->playersNoText->SetText(FText::FromString(noOfPlayersString));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Adds the performance overlay to the HUD widget (unless the widget already has one)
+void AJengaHUD::createPerfOverlay()
+{
+   if (!this->hudWidget)
+      return;
+
+   this->perfOverlayText = getText(PERF_OVERLAY_NAME);
+   if (this->perfOverlayText)
+      return;
+
+   UCanvasPanel* canvas = Cast<UCanvasPanel>(this->hudWidget->GetRootWidget());
+   if (!canvas)
+   {
+      GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, "ERROR: Cannot add the performance overlay to the HUD!");
+      return;
+   }
+
+   this->perfOverlayText = this->hudWidget->WidgetTree->ConstructWidget<UTextBlock>(UTextBlock::StaticClass(), PERF_OVERLAY_NAME);
+   this->perfOverlayText->SetVisibility(ESlateVisibility::HitTestInvisible);
+   UCanvasPanelSlot* slot = canvas->AddChildToCanvas(this->perfOverlayText);
+   slot->SetAutoSize(true);
+   slot->SetPosition(FVector2D(20.f, 20.f));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Shows the latest timings of the player's tower
+void AJengaHUD::updatePerfOverlay()
+{
+   // Only where the tower is simulated (not on network clients)
+   AJengaGameMode* gameMode = Cast<AJengaGameMode>(UGameplayStatics::GetGameMode(GetWorld()));
+   if (!gameMode)
+   {
+      this->perfOverlayText->SetText(FText::FromString("Performance: simulated by the server"));
+      return;
+   }
+
+   FJengaPerfCounters& counters = gameMode->GetPerfCounters();
+   counters.Publish();
+   const FJengaPerfCounters::FValue& latency = counters.GetPublished(FJengaPerfCounters::TURN_LATENCY);
+   const FJengaPerfCounters::FValue& physics = counters.GetPublished(FJengaPerfCounters::PHYSICS_STEP);
+   const FJengaPerfCounters::FValue& snapshot = counters.GetPublished(FJengaPerfCounters::SNAPSHOT);
+   const FJengaPerfCounters::FValue& apply = counters.GetPublished(FJengaPerfCounters::APPLY);
+
+   this->perfOverlayText->SetText(FText::FromString(FString::Printf(
+      TEXT("Turn latency: %.0f ms (max %.0f)\nPhysics step: %.2f ms (max %.2f)\nAwake blocks: %d\nHistory: %.1f KB\nSnapshot: %.3f ms, apply: %.3f ms"),
+      latency.average, latency.max,
+      physics.average, physics.max,
+      gameMode->GetAwakeBlocksCount(),
+      gameMode->GetHistoryMemoryUsage() / 1024.0,
+      snapshot.average, apply.average)));
 }
 
 ///////////////////////////////////////////////////////////////////////////
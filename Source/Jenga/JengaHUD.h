@@ -12,9 +12,10 @@ class UButton;
 class UTextBlock;
 
 /**
- * 
+ * Drives the HUD widget's buttons, and an optional performance overlay
+ * (showPerfOverlay in DefaultGame.ini, -JengaPerfOverlay or the JengaPerfOverlay console command)
  */
-UCLASS()
+UCLASS(Config=Game)
 class JENGA_API AJengaHUD : public AHUD
 {
 	GENERATED_BODY()
@@ -34,12 +35,20 @@ public:
    // Redo last action
    UFUNCTION() void Redo();
 
+   // Console command that shows/hides the performance overlay
+   UFUNCTION(Exec) void JengaPerfOverlay();
+
 protected:
    // Called when the game starts or when spawned
    virtual void BeginPlay() override;
 
+   // Called every frame
+   virtual void Tick(float deltaTime) override;
+
 private:
    void setNoOfPlayers(int n);
+   void createPerfOverlay();
+   void updatePerfOverlay();
 
    // Private utilities
    UButton* getButton(const FName& s);
@@ -50,5 +59,14 @@ private:
    UClass* hudWidgetClass;
    UUserWidget* hudWidget;
 
+   // Widgets updated at runtime (looked up once)
+   UPROPERTY() UButton* playersNoMinusButton;
+   UPROPERTY() UButton* playersNoPlusButton;
+   UPROPERTY() UTextBlock* playersNoText;
+   UPROPERTY() UTextBlock* perfOverlayText;
+
    int noOfPlayers;
+
+   UPROPERTY(Config) bool showPerfOverlay;
+   float perfOverlayTime;
 };
@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaHashTrace.h"
+#include "Jenga.h"
+
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/Archive.h"
+
+
+static const TCHAR RECORD_TYPE_NAMES[] = { 'T', 'S' };
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaHashTrace::FJengaHashTrace()
+{
+   open = false;
+   hasReference = false;
+   step = 0;
+   recorded = mismatches = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Destructor
+FJengaHashTrace::~FJengaHashTrace()
+{
+   Close();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Starts writing a trace and/or comparing with a reference one
+bool FJengaHashTrace::Open(const FString& path, const FString& referencePath)
+{
+   Close();
+
+   if (!referencePath.IsEmpty())
+   {
+      TArray<FString> lines;
+      if (!FFileHelper::LoadFileToStringArray(lines, *referencePath))
+      {
+         UE_LOG(LogJenga, Error, TEXT("Hash trace: cannot read %s"), *referencePath);
+         return false;
+      }
+
+      this->reference.Reserve(lines.Num());
+      for (const auto& line : lines)
+      {
+         FRecord record;
+         if (Parse(line, record))
+            this->reference.Add(record);
+      }
+      this->hasReference = true;
+      UE_LOG(LogJenga, Display, TEXT("Hash trace: comparing with %s (%d records)"), *referencePath, this->reference.Num());
+   }
+
+   if (!path.IsEmpty())
+   {
+      this->file.Reset(IFileManager::Get().CreateFileWriter(*path));
+      if (!this->file)
+      {
+         UE_LOG(LogJenga, Error, TEXT("Hash trace: cannot write %s"), *path);
+         this->reference.Empty();
+         this->hasReference = false;
+         return false;
+      }
+      UE_LOG(LogJenga, Display, TEXT("Hash trace: writing to %s"), *path);
+   }
+
+   this->step = 0;
+   this->recorded = this->mismatches = 0;
+   this->open = this->file.IsValid() || this->hasReference;
+   return this->open;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Stops writing, and logs how the trace compared with the reference one
+void FJengaHashTrace::Close()
+{
+   if (!this->open)
+      return;
+
+   if (this->hasReference)
+   {
+      if (this->mismatches > 0)
+         UE_LOG(LogJenga, Error, TEXT("Hash trace: %d of %d records differ from the reference"), this->mismatches, this->recorded);
+      else if (this->recorded != this->reference.Num())
+         UE_LOG(LogJenga, Warning, TEXT("Hash trace: %d records match, the reference has %d"), this->recorded, this->reference.Num());
+      else
+         UE_LOG(LogJenga, Display, TEXT("Hash trace: all %d records match the reference"), this->recorded);
+   }
+
+   if (this->file)
+   {
+      this->file->Close();
+      this->file.Reset();
+   }
+   this->reference.Empty();
+   this->hasReference = false;
+   this->open = false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Writes a record, and compares it with the reference one
+void FJengaHashTrace::Record(RecordType type, int32 tower, int32 turn, uint64 hash)
+{
+   if (!this->open)
+      return;
+
+   const FRecord record = { this->step, type, tower, turn, hash };
+   if (this->file)
+   {
+      FTCHARToUTF8 utf8(*Format(record));
+      this->file->Serialize((void*)utf8.Get(), utf8.Length());
+   }
+
+   // Records come in the same order as long as the simulations don't diverge
+   if (this->hasReference && this->recorded < this->reference.Num() && !(record == this->reference[this->recorded]))
+   {
+      if (this->mismatches == 0)
+         UE_LOG(LogJenga, Error, TEXT("Hash trace: diverged at record %d: %s (reference: %s)"),
+            this->recorded, *Format(record).TrimEnd(), *Format(this->reference[this->recorded]).TrimEnd());
+      this->mismatches++;
+   }
+   this->recorded++;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Formats a record as a line
+FString FJengaHashTrace::Format(const FRecord& record)
+{
+   return FString::Printf(TEXT("%u %c %d %d %016llx\n"), record.step, RECORD_TYPE_NAMES[record.type], record.tower, record.turn, record.hash);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Parses a line
+bool FJengaHashTrace::Parse(const FString& line, FRecord& outRecord)
+{
+   TArray<FString> fields;
+   if (line.ParseIntoArrayWS(fields) != 5 || fields[1].Len() != 1)
+      return false;
+
+   outRecord.step = (uint32)FCString::Strtoui64(*fields[0], nullptr, 10);
+   outRecord.type = fields[1][0] == RECORD_TYPE_NAMES[STEP] ? STEP : TURN;
+   outRecord.tower = FCString::Atoi(*fields[2]);
+   outRecord.turn = FCString::Atoi(*fields[3]);
+   outRecord.hash = FCString::Strtoui64(*fields[4], nullptr, 16);
+   return true;
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FArchive;
+
+/**
+* Writes the state hashes of the towers to a text file (one "step type tower turn hash"
+* line per record) and/or compares them, as they come, with the trace of a previous run:
+* the first record that differs is logged as the point where the two simulations diverged.
+*/
+class JENGA_API FJengaHashTrace
+{
+public:
+   enum RecordType : uint8 { TURN, STEP };
+
+   FJengaHashTrace();
+   ~FJengaHashTrace();
+
+   // Starts writing a trace and/or comparing with a reference one (either path can be empty)
+   bool Open(const FString& path, const FString& referencePath);
+   void Close();
+   bool IsOpen() const { return open; }
+
+   // Advances the step counter (once per frame)
+   void Step() { step++; }
+
+   void Record(RecordType type, int32 tower, int32 turn, uint64 hash);
+
+private:
+   struct FRecord
+   {
+      uint32 step;
+      RecordType type;
+      int32 tower, turn;
+      uint64 hash;
+
+      bool operator==(const FRecord& other) const
+      {
+         return step == other.step && type == other.type && tower == other.tower && turn == other.turn && hash == other.hash;
+      }
+   };
+
+   static FString Format(const FRecord& record);
+   static bool Parse(const FString& line, FRecord& outRecord);
+
+   bool open;
+   TUniquePtr<FArchive> file;
+   TArray<FRecord> reference;
+   bool hasReference;
+
+   uint32 step;
+   int32 recorded, mismatches;
+};
@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaLayerFreezer.h"
+#include "JengaBlockRegistry.h"
+#include "JengaLayerIndex.h"
+#include "JengaStabilityTracker.h"
+
+#include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaLayerFreezer::FJengaLayerFreezer()
+{
+   this->activeLayers = 3;
+   this->margin = 2;
+   this->restRounds = 2;
+   this->round = 0;
+   this->frozenLayers = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets the freezing thresholds
+void FJengaLayerFreezer::Configure(int32 activeLayers, int32 margin, int32 restRounds)
+{
+   this->activeLayers = activeLayers;
+   this->margin = margin;
+   this->restRounds = restRounds;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets the number of blocks (all of them simulated)
+void FJengaLayerFreezer::Init(int32 nBlocks)
+{
+   this->round = 0;
+   this->frozenLayers = 0;
+   this->lastMovedRounds.Init(0, nBlocks);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A block moved during the current round
+void FJengaLayerFreezer::OnMoved(int32 index)
+{
+   if (this->lastMovedRounds.IsValidIndex(index))
+      this->lastMovedRounds[index] = this->round;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Every block has been moved, and is simulated again
+void FJengaLayerFreezer::OnRestored()
+{
+   this->frozenLayers = 0;
+   for (auto& lastMovedRound : this->lastMovedRounds)
+      lastMovedRound = this->round;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Freezes the bottom layers that have been at rest long enough
+void FJengaLayerFreezer::FreezeSettled(const FJengaBlockRegistry& blocks, const FJengaLayerIndex& layers, FJengaStabilityTracker& stability)
+{
+   this->round++;
+
+   const int32 maxFrozenLayers = layers.GetTopLayer() - this->activeLayers;
+   while (this->frozenLayers < maxFrozenLayers)
+   {
+      const TArray<int32>& layerBlocks = layers.GetLayerBlocks(this->frozenLayers);
+      for (const int32 index : layerBlocks)
+         if (this->round - this->lastMovedRounds[index] < this->restRounds)
+            return;
+
+      // Kinematic bodies don't move, and don't need to be tracked
+      for (const int32 index : layerBlocks)
+      {
+         blocks.GetMesh(index)->SetSimulatePhysics(false);
+         stability.OnSleep(index);
+      }
+      this->frozenLayers++;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Simulates again the frozen layers close to the given one
+void FJengaLayerFreezer::UnfreezeFrom(const FJengaBlockRegistry& blocks, const FJengaLayerIndex& layers, int32 layer)
+{
+   const int32 firstLayer = FMath::Max(0, layer - this->margin);
+   for (int32 l = firstLayer; l < this->frozenLayers; l++)
+      for (const int32 index : layers.GetLayerBlocks(l))
+      {
+         blocks.GetMesh(index)->SetSimulatePhysics(true);
+         this->lastMovedRounds[index] = this->round;
+      }
+   this->frozenLayers = FMath::Min(this->frozenLayers, firstLayer);
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FJengaBlockRegistry;
+class FJengaLayerIndex;
+class FJengaStabilityTracker;
+
+/**
+* Turns the bottom layers of a tower into kinematic bodies once they have been at rest
+* for a few rounds, so that the physics solver only works on the layers that can move.
+* Frozen layers are always the lowest ones: they are simulated again as soon as a pick,
+* or a moving block, gets close to them.
+*/
+class JENGA_API FJengaLayerFreezer
+{
+public:
+   FJengaLayerFreezer();
+
+   // Layers below the top that are always simulated, layers simulated below a pick/moving block,
+   // and rounds a layer must be at rest before being frozen
+   void Configure(int32 activeLayers, int32 margin, int32 restRounds);
+   void Init(int32 nBlocks);
+
+   // A block moved during the current round
+   void OnMoved(int32 index);
+
+   // Every block has been moved (after the frozen layers have been simulated again)
+   void OnRestored();
+
+   // A round ended: freezes the bottom layers that have been at rest long enough
+   void FreezeSettled(const FJengaBlockRegistry& blocks, const FJengaLayerIndex& layers, FJengaStabilityTracker& stability);
+
+   // Something is happening at the given layer: the frozen layers close to it are simulated again
+   void UnfreezeFrom(const FJengaBlockRegistry& blocks, const FJengaLayerIndex& layers, int32 layer);
+
+   // Layers [0, n) are frozen
+   int32 GetFrozenLayers() const { return frozenLayers; }
+   int32 GetMargin() const { return margin; }
+
+private:
+   int32 activeLayers, margin, restRounds;
+   int32 round, frozenLayers;
+   TArray<int32> lastMovedRounds;
+};
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaLayerIndex.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaLayerIndex::FJengaLayerIndex()
+{
+   this->layerHeight = 1.f;
+   this->topLayer = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets the number of blocks and the height of a layer
+void FJengaLayerIndex::Init(int32 nBlocks, float layerHeight)
+{
+   this->layerHeight = layerHeight;
+   this->topLayer = 0;
+   this->blockLayers.Init(0, nBlocks);
+   this->layers.Reset();
+   this->layers.SetNum(1);
+   for (int32 i = 0; i < nBlocks; i++)
+      this->layers[0].Add(i);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Updates the layer of a block given its height
+void FJengaLayerIndex::Update(int32 index, float z)
+{
+   const int32 oldLayer = this->blockLayers[index];
+   const int32 newLayer = LayerOf(z);
+   if (oldLayer == newLayer)
+      return;
+
+   // Move the block to its new bucket
+   this->layers[oldLayer].RemoveSingleSwap(index, false);
+   if (newLayer >= this->layers.Num())
+      this->layers.SetNum(newLayer + 1);
+   this->layers[newLayer].Add(index);
+   this->blockLayers[index] = newLayer;
+
+   // Update the top layer
+   if (newLayer > this->topLayer)
+      this->topLayer = newLayer;
+   else
+      while (this->topLayer > 0 && this->layers[this->topLayer].Num() == 0)
+         this->topLayer--;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the layer corresponding to a given height
+int32 FJengaLayerIndex::LayerOf(float z) const
+{
+   return FMath::Max(0, FMath::RoundToInt(z / this->layerHeight));
+}
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Buckets the blocks by tower layer and keeps track of the top layer.
+* Blocks are moved between buckets only when their layer changes.
+*/
+class JENGA_API FJengaLayerIndex
+{
+public:
+   FJengaLayerIndex();
+
+   // Sets the number of blocks and the height of a layer (all blocks start in layer 0)
+   void Init(int32 nBlocks, float layerHeight);
+
+   // Updates the layer of a block given its height
+   void Update(int32 index, float z);
+
+   // Layer queries
+   int32 GetLayer(int32 index) const { return blockLayers[index]; }
+   int32 GetTopLayer() const { return topLayer; }
+   bool IsOnTop(int32 index) const { return blockLayers[index] == topLayer; }
+   const TArray<int32>& GetLayerBlocks(int32 layer) const { return layers[layer]; }
+   int32 NumLayers() const { return topLayer + 1; }
+
+   // Returns the layer corresponding to a given height
+   int32 LayerOf(float z) const;
+
+private:
+   float layerHeight;
+   TArray<int32> blockLayers;
+   TArray<TArray<int32>> layers;
+   int32 topLayer;
+};
@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaLoadAnalyzer.h"
+#include "JengaStabilityAnalyzer.h"
+
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformTime.h"
+
+
+// Contacts smaller than this (in cm²) are touching edges, not supports
+static const float MIN_CONTACT_AREA = 1.f;
+
+// A removed block is moved this far away on the XY plane: it keeps its layer, but touches nothing
+static const float REMOVED_BLOCK_OFFSET = 100000.f;
+
+
+// A block in the layer below, and the share of the weight it takes
+struct FJengaSupport
+{
+   int32 block;
+   float share;
+};
+typedef TArray<FJengaSupport, TInlineAllocator<4>> FJengaSupports;
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaLoadAnalyzer::FJengaLoadAnalyzer()
+{
+   this->analyzer = nullptr;
+   this->blockSizes = FVector(75.f, 25.f, 15.f);
+   this->risksKnown[0] = this->risksKnown[1] = false;
+   this->front = 0;
+   this->pending = false;
+   this->analysisMs = this->runningMs = 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Destructor
+FJengaLoadAnalyzer::~FJengaLoadAnalyzer()
+{
+   // The worker writes into this object
+   if (this->task.IsValid())
+      this->task.Wait();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets the analyzer and the blocks' sizes
+void FJengaLoadAnalyzer::Configure(const FJengaStabilityAnalyzer* analyzer, const FVector& blockSizes)
+{
+   this->analyzer = analyzer;
+   this->blockSizes = blockSizes;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Analyzes a tower on worker threads
+void FJengaLoadAnalyzer::Request(const TArray<FTransform>& blockPoses)
+{
+   // Only the latest tower matters: older pending ones are dropped
+   this->pendingPoses = blockPoses;
+   this->pending = true;
+   if (!this->task.IsValid())
+      Start();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Publishes a completed analysis and starts the pending one
+bool FJengaLoadAnalyzer::Update()
+{
+   bool published = false;
+   if (this->task.IsValid() && this->task.IsReady())
+   {
+      this->task = TFuture<void>();
+      this->front = 1 - this->front;
+      this->analysisMs = this->runningMs;
+      published = true;
+   }
+
+   if (this->pending && !this->task.IsValid())
+      Start();
+   return published;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Starts analyzing the pending tower into the back buffer
+void FJengaLoadAnalyzer::Start()
+{
+   check(this->analyzer);
+
+   // The worker owns the running poses and the back buffer until it's done
+   this->runningPoses = MoveTemp(this->pendingPoses);
+   this->pendingPoses.Reset();
+   this->pending = false;
+
+   const int32 back = 1 - this->front;
+   this->task = Async<void>(EAsyncExecution::ThreadPool, [this, back]()
+   {
+      const double startSeconds = FPlatformTime::Seconds();
+      this->risksKnown[back] = Analyze(this->runningPoses, this->buffers[back]);
+      this->runningMs = 1000.0 * (FPlatformTime::Seconds() - startSeconds);
+   });
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Analyzes a tower
+bool FJengaLoadAnalyzer::Analyze(const TArray<FTransform>& blockPoses, TArray<FJengaBlockLoad>& outLoads) const
+{
+   check(this->analyzer);
+
+   const int32 nBlocks = blockPoses.Num();
+   outLoads.SetNum(nBlocks, false);
+   if (nBlocks == 0)
+      return true;
+
+   // Bucket blocks by layer (the lowest block is on the floor)
+   float baseZ = MAX_FLT;
+   for (const auto& pose : blockPoses)
+      baseZ = FMath::Min(baseZ, pose.GetLocation().Z);
+
+   TArray<int32> blockLayers;
+   TArray<TArray<int32>> layers;
+   blockLayers.SetNum(nBlocks);
+   for (int32 i = 0; i < nBlocks; i++)
+   {
+      const int32 layer = FMath::Clamp(FMath::RoundToInt((blockPoses[i].GetLocation().Z - baseZ) / this->blockSizes.Z), 0, nBlocks);
+      if (layer >= layers.Num())
+         layers.SetNum(layer + 1);
+      layers[layer].Add(i);
+      blockLayers[i] = layer;
+   }
+
+   // Every block finds what it rests on, and splits its weight among them by contact area
+   TArray<FJengaSupports> supports;
+   supports.SetNum(nBlocks);
+   ParallelFor(nBlocks, [&](int32 i)
+   {
+      if (blockLayers[i] == 0)
+         return;
+
+      float totalArea = 0.f;
+      for (const int32 lower : layers[blockLayers[i] - 1])
+      {
+         const float area = this->analyzer->GetContactArea(blockPoses[i], blockPoses[lower]);
+         if (area >= MIN_CONTACT_AREA)
+         {
+            supports[i].Add({ lower, area });
+            totalArea += area;
+         }
+      }
+      for (auto& support : supports[i])
+         support.share /= totalArea;
+   });
+
+   // Invert the supports, so that every block can pull the weight resting on it
+   TArray<FJengaSupports> supported;
+   supported.SetNum(nBlocks);
+   for (int32 i = 0; i < nBlocks; i++)
+   {
+      outLoads[i].supporting = supports[i].Num();
+      for (const auto& support : supports[i])
+         supported[support.block].Add({ i, support.share });
+   }
+
+   // From the top down: a layer is complete once the one above is
+   for (int32 layer = layers.Num() - 1; layer >= 0; layer--)
+   {
+      const TArray<int32>& layerBlocks = layers[layer];
+      ParallelFor(layerBlocks.Num(), [&](int32 j)
+      {
+         const int32 i = layerBlocks[j];
+         float load = 1.f;
+         for (const auto& upper : supported[i])
+            load += outLoads[upper.block].load * upper.share;
+         outLoads[i].supported = supported[i].Num();
+         outLoads[i].load = load;
+      });
+   }
+
+   // Removing a block costs the tower part of its support margin (all of it when the tower falls)
+   const float distance = this->analyzer->GetSupportDistance(blockPoses);
+   const bool risksKnown = distance > 0.f;
+   ParallelFor(nBlocks, [&](int32 i)
+   {
+      outLoads[i].risk = 0.f;
+      if (!risksKnown)
+         return;
+
+      FTransform removedPose = blockPoses[i];
+      removedPose.AddToTranslation(FVector(REMOVED_BLOCK_OFFSET, 0.f, 0.f));
+      const float removedDistance = this->analyzer->GetSupportDistance(blockPoses, i, removedPose, true);
+      outLoads[i].risk = 1.f - FMath::Clamp(removedDistance / distance, 0.f, 1.f);
+   });
+
+   return risksKnown;
+}
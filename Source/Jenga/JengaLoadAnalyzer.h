@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Future.h"
+
+class FJengaStabilityAnalyzer;
+
+// What a block holds up, and what removing it would cost the tower
+struct FJengaBlockLoad
+{
+   // Blocks it rests on (in the layer below) and blocks resting on it (in the layer above)
+   int32 supporting, supported;
+
+   // Weight it carries, in blocks (itself included), shared among supports by contact area
+   float load;
+
+   // Fraction of the tower's support margin lost without it (1: the tower would fall)
+   float risk;
+};
+
+/**
+* Finds how the weight of a tower flows down through its blocks and how risky
+* removing each block is, from the poses of the blocks only. Towers are analyzed
+* on worker threads (blocks in parallel) while the game goes on: results are
+* written to a back buffer, and published only once the analysis is complete.
+*/
+class JENGA_API FJengaLoadAnalyzer
+{
+public:
+   FJengaLoadAnalyzer();
+
+   // Waits for the running analysis (if any)
+   ~FJengaLoadAnalyzer();
+
+   // Sets the analyzer used to test removals and the blocks' sizes
+   void Configure(const FJengaStabilityAnalyzer* analyzer, const FVector& blockSizes);
+
+   // Analyzes a tower on worker threads (a request made while busy replaces the pending one)
+   void Request(const TArray<FTransform>& blockPoses);
+
+   // Publishes a completed analysis and starts the pending one (never waits). True if published.
+   bool Update();
+
+   // Results of the last published analysis (empty until the first one)
+   const TArray<FJengaBlockLoad>& GetLoads() const { return buffers[front]; }
+   bool AreRisksKnown() const { return risksKnown[front]; }
+   double GetLastAnalysisMs() const { return analysisMs; }
+   bool IsBusy() const { return task.IsValid(); }
+
+   // Analyzes a tower, given the transforms of its blocks' centres. False if the risks
+   // can't be told (the tower is tilted or already falling). (thread safe)
+   bool Analyze(const TArray<FTransform>& blockPoses, TArray<FJengaBlockLoad>& outLoads) const;
+
+private:
+   void Start();
+
+   const FJengaStabilityAnalyzer* analyzer;
+   FVector blockSizes;
+
+   // Published (front) and in-progress (back) results
+   TArray<FJengaBlockLoad> buffers[2];
+   bool risksKnown[2];
+   int32 front;
+
+   TArray<FTransform> runningPoses, pendingPoses;
+   bool pending;
+   TFuture<void> task;
+   double analysisMs, runningMs;
+};
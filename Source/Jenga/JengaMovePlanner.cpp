@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaMovePlanner.h"
+#include "JengaStabilityAnalyzer.h"
+
+#include "Async/ParallelFor.h"
+#include "HAL/PlatformTime.h"
+#include "HAL/ThreadSafeCounter.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaMovePlanner::FJengaMovePlanner()
+{
+   this->analyzer = nullptr;
+   this->blockSizes = FVector(75.f, 25.f, 15.f);
+   this->pullSteps = 4;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets the analyzer, the blocks' sizes and the pull steps
+void FJengaMovePlanner::Configure(const FJengaStabilityAnalyzer* analyzer, const FVector& blockSizes, int32 pullSteps)
+{
+   this->analyzer = analyzer;
+   this->blockSizes = blockSizes;
+   this->pullSteps = FMath::Max(1, pullSteps);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Adds both pull directions of the given blocks
+void FJengaMovePlanner::MakeCandidates(const TArray<int32>& blocks, TArray<FJengaMoveCandidate>& outCandidates)
+{
+   outCandidates.Reset(2 * blocks.Num());
+   for (const int32 block : blocks)
+   {
+      outCandidates.Add({ block, 1.f, -MAX_FLT, false });
+      outCandidates.Add({ block, -1.f, -MAX_FLT, false });
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Scores as many candidates as possible within the budget
+int32 FJengaMovePlanner::Evaluate(
+   const TArray<FTransform>& blockPoses,
+   const FVector& topPlacement,
+   TArray<FJengaMoveCandidate>& candidates,
+   double budgetSeconds) const
+{
+   check(this->analyzer);
+
+   // Every candidate only reads the shared poses, and writes its own score
+   const double deadline = FPlatformTime::Seconds() + budgetSeconds;
+   FThreadSafeCounter evaluated;
+   ParallelFor(candidates.Num(), [&](int32 i)
+   {
+      if (FPlatformTime::Seconds() > deadline)
+         return;
+
+      candidates[i].score = Score(blockPoses, topPlacement, candidates[i]);
+      candidates[i].evaluated = true;
+      evaluated.Increment();
+   });
+
+   return evaluated.GetValue();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the best evaluated candidate
+int32 FJengaMovePlanner::FindBest(const TArray<FJengaMoveCandidate>& candidates)
+{
+   int32 best = INDEX_NONE;
+   for (int32 i = 0; i < candidates.Num(); i++)
+      if (candidates[i].evaluated && (best == INDEX_NONE || candidates[i].score > candidates[best].score))
+         best = i;
+   return best;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Plays a candidate and returns the weakest support distance met
+float FJengaMovePlanner::Score(const TArray<FTransform>& blockPoses, const FVector& topPlacement, const FJengaMoveCandidate& candidate) const
+{
+   const FTransform& start = blockPoses[candidate.block];
+   const FVector pullDir = FVector(start.GetRotation().GetAxisX().X, start.GetRotation().GetAxisX().Y, 0.f).GetSafeNormal() * candidate.direction;
+
+   // While pulled, the block still supports the tower above it
+   float score = MAX_FLT;
+   FTransform moved = start;
+   for (int32 step = 1; step <= this->pullSteps; step++)
+   {
+      moved.SetLocation(start.GetLocation() + pullDir * (this->blockSizes.X * step / this->pullSteps));
+      score = FMath::Min(score, this->analyzer->GetSupportDistance(blockPoses, candidate.block, moved, true));
+   }
+
+   // Then it lies on top (its rotation is locked while dragged)
+   moved.SetLocation(topPlacement);
+   return FMath::Min(score, this->analyzer->GetSupportDistance(blockPoses, candidate.block, moved, false));
+}
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FJengaStabilityAnalyzer;
+
+// A move: pull a block out of the tower in one direction along its long axis, then put it on top
+struct FJengaMoveCandidate
+{
+   int32 block;
+   float direction;
+   float score;
+   bool evaluated;
+};
+
+/**
+* Scores candidate moves by collapse risk, on worker threads and within a time budget.
+* Every candidate is played in a throwaway copy of the tower's poses: the block is pulled
+* out step by step, then placed on top, and the score is the weakest support distance met
+* along the way (see FJengaStabilityAnalyzer).
+*/
+class JENGA_API FJengaMovePlanner
+{
+public:
+   FJengaMovePlanner();
+
+   // Sets the analyzer used to score the tower, the blocks' sizes and how many steps a pull is split into
+   void Configure(const FJengaStabilityAnalyzer* analyzer, const FVector& blockSizes, int32 pullSteps);
+
+   // Adds both pull directions of the given blocks
+   static void MakeCandidates(const TArray<int32>& blocks, TArray<FJengaMoveCandidate>& outCandidates);
+
+   // Scores as many candidates as possible within the budget (returns how many were evaluated)
+   int32 Evaluate(
+      const TArray<FTransform>& blockPoses,
+      const FVector& topPlacement,
+      TArray<FJengaMoveCandidate>& candidates,
+      double budgetSeconds
+   ) const;
+
+   // Returns the best evaluated candidate (INDEX_NONE if none)
+   static int32 FindBest(const TArray<FJengaMoveCandidate>& candidates);
+
+private:
+   float Score(const TArray<FTransform>& blockPoses, const FVector& topPlacement, const FJengaMoveCandidate& candidate) const;
+
+   const FJengaStabilityAnalyzer* analyzer;
+   FVector blockSizes;
+   int32 pullSteps;
+};
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaPerfCounters.h"
+
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "HAL/PlatformTime.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaPerfCounters::FJengaPerfCounters()
+{
+   for (int32 i = 0; i < COUNTERS_COUNT; i++)
+   {
+      this->accumulators[i] = { 0.0, 0.0, 0 };
+      this->published[i] = { 0.0, 0.0 };
+      this->lastSamples[i] = 0.0;
+      this->samplesCounts[i] = 0;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Adds a sample
+void FJengaPerfCounters::Add(Counter counter, double ms)
+{
+   FAccumulator& accumulator = this->accumulators[counter];
+   accumulator.sum += ms;
+   accumulator.max = FMath::Max(accumulator.max, ms);
+   accumulator.count++;
+
+   this->lastSamples[counter] = ms;
+   this->samplesCounts[counter]++;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Aggregates the samples taken since the last call
+void FJengaPerfCounters::Publish()
+{
+   for (int32 i = 0; i < COUNTERS_COUNT; i++)
+   {
+      FAccumulator& accumulator = this->accumulators[i];
+      if (accumulator.count == 0)
+         continue;
+
+      this->published[i] = { accumulator.sum / accumulator.count, accumulator.max };
+      accumulator = { 0.0, 0.0, 0 };
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaPhysicsTimer::FJengaPhysicsTimer()
+{
+   this->world = nullptr;
+   this->counters = nullptr;
+   this->startSeconds = 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Starts timing the physics step of a world
+void FJengaPhysicsTimer::Register(UWorld* world, FJengaPerfCounters* counters)
+{
+   this->world = world;
+   this->counters = counters;
+
+   // The engine starts the simulation right after the start tick, and the end tick runs once it's over
+   this->startTick.timer = this->endTick.timer = this;
+   this->startTick.isStart = true;
+   this->endTick.isStart = false;
+   this->startTick.bCanEverTick = this->endTick.bCanEverTick = true;
+   this->startTick.TickGroup = TG_StartPhysics;
+   this->endTick.TickGroup = TG_EndPhysics;
+   this->startTick.RegisterTickFunction(world->PersistentLevel);
+   this->endTick.RegisterTickFunction(world->PersistentLevel);
+   world->StartPhysicsTickFunction.AddPrerequisite(world, this->startTick);
+   this->endTick.AddPrerequisite(world, world->EndPhysicsTickFunction);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Stops timing
+void FJengaPhysicsTimer::Unregister()
+{
+   if (!this->world)
+      return;
+
+   this->world->StartPhysicsTickFunction.RemovePrerequisite(this->world, this->startTick);
+   this->startTick.UnRegisterTickFunction();
+   this->endTick.UnRegisterTickFunction();
+   this->world = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Physics is about to start, or it's over
+void FJengaPhysicsTimer::FTimerTickFunction::ExecuteTick(float deltaTime, ELevelTick tickType, ENamedThreads::Type currentThread, const FGraphEventRef& completionGraphEvent)
+{
+   if (this->isStart)
+      this->timer->startSeconds = FPlatformTime::Seconds();
+   else if (this->timer->counters)
+      this->timer->counters->Add(FJengaPerfCounters::PHYSICS_STEP, 1000.0 * (FPlatformTime::Seconds() - this->timer->startSeconds));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Name shown in the tick diagnostics
+FString FJengaPhysicsTimer::FTimerTickFunction::DiagnosticMessage()
+{
+   return this->isStart ? TEXT("FJengaPhysicsTimer[Start]") : TEXT("FJengaPhysicsTimer[End]");
+}
@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformTime.h"
+#include "Engine/EngineBaseTypes.h"
+
+class UWorld;
+
+/**
+* Timings of the player's tower (in milliseconds), aggregated as they are sampled.
+* Readers publish them at their own rate: each publish turns the samples taken since
+* the previous one into an average and a max, and keeps the last published values of
+* the counters without new samples (e.g. the turn latency between two turns).
+*/
+class JENGA_API FJengaPerfCounters
+{
+public:
+   enum Counter { TURN_LATENCY, PHYSICS_STEP, SNAPSHOT, APPLY, COUNTERS_COUNT };
+
+   struct FValue
+   {
+      double average, max;
+   };
+
+   FJengaPerfCounters();
+
+   void Add(Counter counter, double ms);
+
+   // Aggregates the samples taken since the last call
+   void Publish();
+   const FValue& GetPublished(Counter counter) const { return published[counter]; }
+
+   // Raw samples, for readers that need every one of them (e.g. percentiles)
+   double GetLastSample(Counter counter) const { return lastSamples[counter]; }
+   uint32 GetSamplesCount(Counter counter) const { return samplesCounts[counter]; }
+
+private:
+   struct FAccumulator
+   {
+      double sum, max;
+      int32 count;
+   };
+
+   FAccumulator accumulators[COUNTERS_COUNT];
+   FValue published[COUNTERS_COUNT];
+   double lastSamples[COUNTERS_COUNT];
+   uint32 samplesCounts[COUNTERS_COUNT];
+};
+
+// Times the enclosing scope into a counter (if any)
+class FJengaPerfScope
+{
+public:
+   FJengaPerfScope(FJengaPerfCounters* counters, FJengaPerfCounters::Counter counter)
+      : counters(counters), counter(counter), startSeconds(counters ? FPlatformTime::Seconds() : 0.0) {}
+   ~FJengaPerfScope()
+   {
+      if (this->counters)
+         this->counters->Add(this->counter, 1000.0 * (FPlatformTime::Seconds() - this->startSeconds));
+   }
+
+private:
+   FJengaPerfCounters* counters;
+   FJengaPerfCounters::Counter counter;
+   double startSeconds;
+};
+
+/**
+* Times the physics step of a world: from right before the physics simulation starts
+* to right after the game thread got its results.
+*/
+class JENGA_API FJengaPhysicsTimer
+{
+public:
+   FJengaPhysicsTimer();
+
+   void Register(UWorld* world, FJengaPerfCounters* counters);
+   void Unregister();
+
+private:
+   struct FTimerTickFunction : public FTickFunction
+   {
+      FJengaPhysicsTimer* timer;
+      bool isStart;
+
+      virtual void ExecuteTick(float deltaTime, ELevelTick tickType, ENamedThreads::Type currentThread, const FGraphEventRef& completionGraphEvent) override;
+      virtual FString DiagnosticMessage() override;
+   };
+
+   UWorld* world;
+   FJengaPerfCounters* counters;
+   FTimerTickFunction startTick, endTick;
+   double startSeconds;
+};
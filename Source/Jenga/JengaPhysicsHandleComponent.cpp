@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaPhysicsHandleComponent.h"
+#include "JengaStats.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "Misc/ScopeLock.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+UJengaPhysicsHandleComponent::UJengaPhysicsHandleComponent()
+{
+   // Targets are already smooth: they are interpolated at every sub-step
+   bInterpolateTarget = false;
+   stepTime = 0.f;
+   onSubstep.BindUObject(this, &UJengaPhysicsHandleComponent::OnSubstep);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Starts dragging a component from the given point
+void UJengaPhysicsHandleComponent::Grab(UPrimitiveComponent* component, const FVector& grabPoint)
+{
+   {
+      FScopeLock lock(&this->targetsLock);
+      this->targets.Reset();
+   }
+
+   GrabComponentAtLocation(component, NAME_None, grabPoint);
+   PushTarget(grabPoint);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Stops dragging
+void UJengaPhysicsHandleComponent::Release()
+{
+   ReleaseComponent();
+
+   FScopeLock lock(&this->targetsLock);
+   this->targets.Reset();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Adds a drag target, reached at the current world time
+void UJengaPhysicsHandleComponent::PushTarget(const FVector& target)
+{
+   {
+      FScopeLock lock(&this->targetsLock);
+      this->targets.Push(GetWorld()->GetTimeSeconds(), target);
+   }
+
+   // Frames without sub-steps still get the latest target
+   SetTargetLocation(target);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called every frame, before physics
+void UJengaPhysicsHandleComponent::TickComponent(float deltaTime, enum ELevelTick tickType, FActorComponentTickFunction* thisTickFunction)
+{
+   Super::TickComponent(deltaTime, tickType, thisTickFunction);
+
+   // The coming physics step goes from the previous frame's time to this one
+   if (this->GrabbedComponent)
+      if (FBodyInstance* bodyInstance = this->GrabbedComponent->GetBodyInstance(this->GrabbedBoneName))
+      {
+         this->stepTime = GetWorld()->GetTimeSeconds() - deltaTime;
+         bodyInstance->AddCustomPhysics(this->onSubstep);
+      }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Moves the handle to the target interpolated at the sub-step's time
+void UJengaPhysicsHandleComponent::OnSubstep(float deltaTime, FBodyInstance* bodyInstance)
+{
+   JENGA_SCOPE_CYCLE_COUNTER(STAT_JengaDragSubstep);
+   this->stepTime += deltaTime;
+
+   FVector target;
+   {
+      FScopeLock lock(&this->targetsLock);
+      if (this->targets.IsEmpty())
+         return;
+      target = this->targets.Sample(this->stepTime);
+   }
+
+   FTransform transform = this->TargetTransform;
+   transform.SetLocation(target);
+   UpdateHandleTransform(transform);
+}
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PhysicsEngine/PhysicsHandleComponent.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "HAL/CriticalSection.h"
+#include "JengaDragBuffer.h"
+#include "JengaPhysicsHandleComponent.generated.h"
+
+/**
+* A physics handle that moves its target at every physics sub-step instead of
+* once per frame: drag targets are buffered with their time, and every sub-step
+* gets the target interpolated at its own time. Dragging then behaves the same
+* at any frame rate.
+*/
+UCLASS()
+class JENGA_API UJengaPhysicsHandleComponent : public UPhysicsHandleComponent
+{
+   GENERATED_BODY()
+
+public:
+   // Constructor
+   UJengaPhysicsHandleComponent();
+
+   // Starts/stops dragging a component (the handle is reused for every pick)
+   void Grab(UPrimitiveComponent* component, const FVector& grabPoint);
+   void Release();
+
+   // Adds a drag target, reached at the current world time
+   void PushTarget(const FVector& target);
+
+   virtual void TickComponent(float deltaTime, enum ELevelTick tickType, FActorComponentTickFunction* thisTickFunction) override;
+
+private:
+   // Called at every physics sub-step while a component is grabbed
+   void OnSubstep(float deltaTime, FBodyInstance* bodyInstance);
+
+   // Targets are pushed by the game thread and read by physics sub-steps
+   FJengaDragBuffer targets;
+   FCriticalSection targetsLock;
+
+   FCalculateCustomPhysics onSubstep;
+   float stepTime;
+};
@@ -2,11 +2,12 @@
 
 #include "JengaPlayerController.h"
 #include "JengaGameMode.h"
+#include "JengaStats.h"
+#include "JengaPhysicsHandleComponent.h"
 
 #include "Components/PrimitiveComponent.h"
 #include "Runtime/Engine/Classes/Engine/Engine.h"
 #include "Runtime/Engine/Classes/Kismet/GameplayStatics.h"
-#include "Runtime/Engine/Classes/PhysicsEngine/PhysicsHandleComponent.h"
 #include "DrawDebugHelpers.h"
 
 
@@ -26,7 +27,14 @@ const float RAY_LENGTH = 2000;
 // Constructor
 AJengaPlayerController::AJengaPlayerController()
 {
-   physicsHandle = nullptr;
+   physicsHandle = CreateDefaultSubobject<UJengaPhysicsHandleComponent>(TEXT("PhysicsHandle"));
+   grabbedComponent = nullptr;
+   pendingComponent = nullptr;
+   unansweredPicks = 0;
+   pickRefused = false;
+   grabDistance = 0.f;
+   towerOffset = FVector::ZeroVector;
+   scripted = false;
    bShowMouseCursor = true;
 }
 
@@ -43,18 +51,22 @@ void AJengaPlayerController::Tick(float deltaTime)
 {
    Super::Tick(deltaTime);
 
+   // Scripted dragging doesn't read the mouse (and remote players' mouse is read by their client)
+   if (this->scripted || !IsLocalController())
+      return;
+
    // Is mouse left button down?
    if (IsInputKeyDown(EKeys::LeftMouseButton))
    {
       FVector2D mouseScreenPos;
       GetMousePosition(mouseScreenPos.X, mouseScreenPos.Y);
 
-      // First frame with mouse pressed? Start dragging
-      if (this->lastPick.GetComponent() == nullptr)
+      // First frame with mouse pressed? Start dragging (clients wait for the server to accept the pick)
+      if (!IsDragging() && !IsWaitingForPick())
          DraggingStart(mouseScreenPos);
 
       // Else, update dragging
-      else
+      else if (IsDragging())
          DraggingUpdate(mouseScreenPos);
    }
 
@@ -63,41 +75,102 @@ void AJengaPlayerController::Tick(float deltaTime)
       DraggingStop();
 }
 
+///////////////////////////////////////////////////////////////////////////
+// Console command that saves the game
+void AJengaPlayerController::JengaSave(const FString& name)
+{
+   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
+   if (gameMode)
+      gameMode->SaveGame(name);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Console command that loads a game
+void AJengaPlayerController::JengaLoad(const FString& name)
+{
+   ReleaseBlock();
+   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
+   if (gameMode)
+      gameMode->LoadGame(name);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Console command to replay the current turn as played on another branch
+void AJengaPlayerController::JengaBranch(int32 branch)
+{
+   RequestBranch(branch - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Console command that shows/hides the removal risk heatmap
+void AJengaPlayerController::JengaLoadHeatmap()
+{
+   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
+   if (gameMode)
+      gameMode->ToggleLoadHeatmap();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Starts a new game
+void AJengaPlayerController::RequestNewGame(int nPlayers)
+{
+   if (!HasAuthority())
+      ServerNewGame(nPlayers);
+   else if (AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld()))
+      gameMode->NewGame(this, nPlayers);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Goes back to the previous round
+void AJengaPlayerController::RequestUndo()
+{
+   if (!HasAuthority())
+      ServerUndo();
+   else if (AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld()))
+      gameMode->Undo(this);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Restores a canceled round
+void AJengaPlayerController::RequestRedo()
+{
+   if (!HasAuthority())
+      ServerRedo();
+   else if (AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld()))
+      gameMode->Redo(this);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Replays the current turn as played on another branch
+void AJengaPlayerController::RequestBranch(int32 branch)
+{
+   if (!HasAuthority())
+      ServerBranch(branch);
+   else if (AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld()))
+      gameMode->SwitchBranch(this, branch);
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Tries to pick an actor from given screen space coordinates and attaches a physic handle to it
 void AJengaPlayerController::DraggingStart(FVector2D screenPos)
 {
+   // Not this player's turn (clients are checked by the server, and don't ask again until the button is released)
+   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
+   if ((HasAuthority() && gameMode && !gameMode->CanPlay(this)) || this->pickRefused)
+      return;
+
    // Retrieving mouse position in world
    FVector worldPos, worldDir;
    DeprojectScreenPositionToWorld(screenPos.X, screenPos.Y, worldPos, worldDir);
 
    // Ray-tracing to find a pickable actor
-   this->lastPick.Reset();
+   FHitResult hit;
    FVector rayStart = worldPos;
    FVector rayEnd = rayStart + worldDir * RAY_LENGTH;
-   if (GetWorld()->LineTraceSingleByChannel(this->lastPick, rayStart, rayEnd, ECollisionChannel::ECC_Visibility))
+   if (GetWorld()->LineTraceSingleByChannel(hit, rayStart, rayEnd, ECollisionChannel::ECC_Visibility))
    {
-      AActor* pickedActor = this->lastPick.GetComponent()->GetOwner();
-      if (pickedActor->Tags.Contains("Interactive"))
-      {
-         // Creating the handle
-         physicsHandle = NewObject<UPhysicsHandleComponent>(this, TEXT("PhysicsHandle"));
-         physicsHandle->GrabComponent(this->lastPick.GetComponent(), NAME_None, this->lastPick.ImpactPoint, false);
-         physicsHandle->SetTargetLocation(this->lastPick.ImpactPoint);
-         physicsHandle->RegisterComponent();
-
-         // Locking component rotations
-         lockRotations(*this->lastPick.GetComponent(), true);
-
-         // Updating the GameMode
-         AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
-         gameMode->NewPick(pickedActor);
-      }
-      else
-      {
-         // Picking a not-interactive actor
-         this->lastPick.Reset();
-      }
+      if (PickBlock(hit.GetComponent(), hit.ImpactPoint))
+         this->grabDistance = hit.Distance;
    }
 }
 
@@ -107,31 +180,212 @@ void AJengaPlayerController::DraggingUpdate(FVector2D screenPos)
 {
    FVector worldPos, worldDir;
    DeprojectScreenPositionToWorld(screenPos.X, screenPos.Y, worldPos, worldDir);
-   FVector target = worldPos + worldDir * this->lastPick.Distance;
-   physicsHandle->SetTargetLocation(target);
+   DragTo(worldPos + worldDir * this->grabDistance);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Releases the physic handle
+void AJengaPlayerController::DraggingStop()
+{
+   if (IsDragging() || IsWaitingForPick())
+      ReleaseBlock();
+   this->pickRefused = false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Attaches a physic handle to a block (if it's interactive)
+bool AJengaPlayerController::PickBlock(UPrimitiveComponent* blockComponent, const FVector& grabPoint)
+{
+   if (!blockComponent || IsDragging() || IsWaitingForPick())
+      return false;
+
+   // Clients only ask: the server checks the block and moves it, and tells whether they can drag it
+   if (!HasAuthority())
+   {
+      ServerPickBlock(blockComponent, grabPoint);
+      this->pendingComponent = blockComponent;
+      this->unansweredPicks++;
+      this->grabPoint = grabPoint;
+      return true;
+   }
+
+   // Picking a not-interactive actor
+   AActor* pickedActor = blockComponent->GetOwner();
+   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
+   if (!gameMode->IsInteractive(pickedActor))
+      return false;
+
+   // Updating the GameMode first (it makes sure the block is simulated)
+   gameMode->NewPick(pickedActor, grabPoint);
+
+   // Grabbing with the handle
+   physicsHandle->Grab(blockComponent, grabPoint);
+
+   // Locking component rotations
+   lockRotations(*blockComponent, true);
+   this->grabbedComponent = blockComponent;
+   this->grabPoint = grabPoint;
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Moves the physic handle target
+void AJengaPlayerController::DragTo(const FVector& target)
+{
+   JENGA_SCOPE_CYCLE_COUNTER(STAT_JengaDrag);
+
+   if (!IsDragging())
+      return;
+
+   if (!HasAuthority())
+   {
+      ServerDragTo(target);
+      return;
+   }
+
+   // Physics sub-steps interpolate between the targets of consecutive frames
+   physicsHandle->PushTarget(target);
+
+   // Updating the GameMode
+   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
+   gameMode->DragUpdated(this->grabbedComponent->GetOwner(), target);
 
 #if defined(UE_BUILD_DEBUG)
    // Draw debug arrow
-   DrawDebugDirectionalArrow(GetWorld(), this->lastPick.ImpactPoint, target, 10, FColor::Red, false, -1.0f, 0, 1.0f);
+   DrawDebugDirectionalArrow(GetWorld(), this->grabPoint, target, 10, FColor::Red, false, -1.0f, 0, 1.0f);
 #endif
 }
 
 ///////////////////////////////////////////////////////////////////////////
-// Releases the physic handle
-void AJengaPlayerController::DraggingStop()
+// Releases the picked block
+void AJengaPlayerController::ReleaseBlock()
 {
-   if (this->lastPick.GetComponent())
+   if (!IsDragging() && !IsWaitingForPick())
+      return;
+
+   // A pick not answered yet is canceled too (the server gets the release after it)
+   if (!HasAuthority())
    {
-      AActor* pickedActor = this->lastPick.GetComponent()->GetOwner();
+      ServerReleaseBlock();
+      this->grabbedComponent = nullptr;
+      this->pendingComponent = nullptr;
+      return;
+   }
+
+   AActor* pickedActor = this->grabbedComponent->GetOwner();
+
+   // Updating the GameMode
+   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
+   gameMode->PickReleased(pickedActor);
+
+   lockRotations(*this->grabbedComponent, false);
+   this->grabbedComponent = nullptr;
+   physicsHandle->Release();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A client picks a block
+void AJengaPlayerController::ServerPickBlock_Implementation(UPrimitiveComponent* blockComponent, FVector_NetQuantize100 grabPoint)
+{
+   // Clients see their tower in place of the level's one
+   AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
+   const bool accepted = gameMode && gameMode->CanPlay(this)
+      && PickBlock(gameMode->GetPlayerBlock(this, blockComponent, this->towerOffset), grabPoint + this->towerOffset);
+   ClientPickAnswered(accepted);
+}
+
+bool AJengaPlayerController::ServerPickBlock_Validate(UPrimitiveComponent* blockComponent, FVector_NetQuantize100 grabPoint)
+{
+   return true;
+}
 
-      // Updating the GameMode
-      AJengaGameMode* gameMode = (AJengaGameMode*)UGameplayStatics::GetGameMode(GetWorld());
-      gameMode->PickReleased(pickedActor);
+///////////////////////////////////////////////////////////////////////////
+// The server accepted or refused this client's pick
+void AJengaPlayerController::ClientPickAnswered_Implementation(bool accepted)
+{
+   // Answers come in order: only the one to the last pick matters, if it hasn't been canceled meanwhile
+   this->unansweredPicks = FMath::Max(0, this->unansweredPicks - 1);
+   if (this->unansweredPicks > 0 || !IsWaitingForPick())
+      return;
 
-      lockRotations(*this->lastPick.GetComponent(), false);
-      this->lastPick.Reset();
-      physicsHandle->ReleaseComponent();
+   if (accepted)
+      this->grabbedComponent = this->pendingComponent;
+   else
+   {
+      this->pickRefused = true;
+      GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Red, TEXT("Cannot pick this block now"));
    }
+   this->pendingComponent = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A client drags its block
+void AJengaPlayerController::ServerDragTo_Implementation(FVector_NetQuantize100 target)
+{
+   DragTo(target + this->towerOffset);
+}
+
+bool AJengaPlayerController::ServerDragTo_Validate(FVector_NetQuantize100 target)
+{
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A client releases its block
+void AJengaPlayerController::ServerReleaseBlock_Implementation()
+{
+   ReleaseBlock();
+}
+
+bool AJengaPlayerController::ServerReleaseBlock_Validate()
+{
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A client starts a new game
+void AJengaPlayerController::ServerNewGame_Implementation(int32 nPlayers)
+{
+   RequestNewGame(nPlayers);
+}
+
+bool AJengaPlayerController::ServerNewGame_Validate(int32 nPlayers)
+{
+   return nPlayers > 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A client undoes a round
+void AJengaPlayerController::ServerUndo_Implementation()
+{
+   RequestUndo();
 }
 
+bool AJengaPlayerController::ServerUndo_Validate()
+{
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A client redoes a round
+void AJengaPlayerController::ServerRedo_Implementation()
+{
+   RequestRedo();
+}
 
+bool AJengaPlayerController::ServerRedo_Validate()
+{
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A client switches to another branch
+void AJengaPlayerController::ServerBranch_Implementation(int32 branch)
+{
+   RequestBranch(branch);
+}
+
+bool AJengaPlayerController::ServerBranch_Validate(int32 branch)
+{
+   return branch >= 0;
+}
@@ -4,9 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerController.h"
+#include "Engine/NetSerialization.h"
 #include "JengaPlayerController.generated.h"
 
-class UPhysicsHandleComponent;
+class UJengaPhysicsHandleComponent;
+class UPrimitiveComponent;
 
 /**
 *
@@ -20,7 +22,45 @@ public:
    // Constructor
    AJengaPlayerController();
 
+   // Scripted dragging: when enabled the mouse is ignored (e.g. headless simulations)
+   void SetScripted(bool b) { scripted = b; }
+   bool PickBlock(UPrimitiveComponent* blockComponent, const FVector& grabPoint);
+   void DragTo(const FVector& target);
+   void ReleaseBlock();
+   bool IsDragging() const { return grabbedComponent != nullptr; }
+
+   // Is this client waiting for the server to accept its pick? (it drags only once accepted)
+   bool IsWaitingForPick() const { return pendingComponent != nullptr; }
+
+   // Game commands (sent to the server when playing as a client)
+   void RequestNewGame(int nPlayers);
+   void RequestUndo();
+   void RequestRedo();
+   void RequestBranch(int32 branch);
+
+   // Console commands to save/load the game
+   UFUNCTION(Exec) void JengaSave(const FString& name);
+   UFUNCTION(Exec) void JengaLoad(const FString& name);
+
+   // Console command to replay the current turn as played on another branch (starting from 1)
+   UFUNCTION(Exec) void JengaBranch(int32 branch);
+
+   // Console command to show/hide the removal risk heatmap (server and standalone games only)
+   UFUNCTION(Exec) void JengaLoadHeatmap();
+
 protected:
+   // Clients' pick/drag/release flow and commands, played by the server
+   UFUNCTION(Server, Reliable, WithValidation) void ServerPickBlock(UPrimitiveComponent* blockComponent, FVector_NetQuantize100 grabPoint);
+   UFUNCTION(Server, Unreliable, WithValidation) void ServerDragTo(FVector_NetQuantize100 target);
+   UFUNCTION(Server, Reliable, WithValidation) void ServerReleaseBlock();
+   UFUNCTION(Server, Reliable, WithValidation) void ServerNewGame(int32 nPlayers);
+   UFUNCTION(Server, Reliable, WithValidation) void ServerUndo();
+   UFUNCTION(Server, Reliable, WithValidation) void ServerRedo();
+   UFUNCTION(Server, Reliable, WithValidation) void ServerBranch(int32 branch);
+
+   // Server's answer to a client's pick
+   UFUNCTION(Client, Reliable) void ClientPickAnswered(bool accepted);
+
    // Called when the game starts or when spawned
    virtual void BeginPlay() override;
 
@@ -34,7 +74,20 @@ private:
    void DraggingUpdate(FVector2D screenPos);
    void DraggingStop();
 
-   UPhysicsHandleComponent* physicsHandle;
-   FHitResult lastPick;
+   // A single handle, reused for every pick
+   UPROPERTY() UJengaPhysicsHandleComponent* physicsHandle;
+   UPrimitiveComponent* grabbedComponent;
+   FVector grabPoint;
+   float grabDistance;
+   bool scripted;
+
+   // Client side: the block asked to the server, the picks not answered yet, and whether
+   // the last one was refused (no more picks until the mouse button is released)
+   UPrimitiveComponent* pendingComponent;
+   int32 unansweredPicks;
+   bool pickRefused;
+
+   // Server side: how far this client's tower is from the level's one
+   FVector towerOffset;
 	
 };
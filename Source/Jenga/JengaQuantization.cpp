@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaQuantization.h"
+
+
+const float FJengaQuantizedTransform::POSITION_STEP = 1.f / 64.f;
+
+// Smallest three encoding: the three smallest components of a unit quaternion lie in [-1/sqrt(2), 1/sqrt(2)]
+static const int32 ROTATION_BITS = 15;
+static const uint64 ROTATION_MASK = (1 << ROTATION_BITS) - 1;
+static const float ROTATION_RANGE = 0.70710678f;
+static const int32 ROTATION_PACKED_BITS = 2 + 3 * ROTATION_BITS;
+
+// Network packets store positions as unsigned offsets on this number of bits
+static const int32 NET_POSITION_BITS = 24;
+static const int32 NET_POSITION_OFFSET = 1 << (NET_POSITION_BITS - 1);
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaQuantizedTransform::FJengaQuantizedTransform(const FTransform& transform)
+{
+   this->position = QuantizePosition(transform.GetLocation());
+   this->rotation = QuantizeRotation(transform.GetRotation());
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the (approximated) transform
+FTransform FJengaQuantizedTransform::ToTransform() const
+{
+   return FTransform(DequantizeRotation(this->rotation), DequantizePosition(this->position));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Quantizes a position
+FIntVector FJengaQuantizedTransform::QuantizePosition(const FVector& position)
+{
+   return FIntVector(
+      FMath::RoundToInt(position.X / POSITION_STEP),
+      FMath::RoundToInt(position.Y / POSITION_STEP),
+      FMath::RoundToInt(position.Z / POSITION_STEP)
+   );
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Restores a quantized position
+FVector FJengaQuantizedTransform::DequantizePosition(const FIntVector& position)
+{
+   return FVector(position.X, position.Y, position.Z) * POSITION_STEP;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Quantizes a rotation dropping its largest component
+uint64 FJengaQuantizedTransform::QuantizeRotation(const FQuat& rotation)
+{
+   FQuat q = rotation.GetNormalized();
+   float components[4] = { q.X, q.Y, q.Z, q.W };
+
+   // Find the largest component (it will be rebuilt from the other ones)
+   int32 largest = 0;
+   for (int32 i = 1; i < 4; i++)
+      if (FMath::Abs(components[i]) > FMath::Abs(components[largest]))
+         largest = i;
+
+   // q and -q are the same rotation: make the largest one positive
+   const float sign = components[largest] < 0.f ? -1.f : 1.f;
+
+   uint64 packed = largest;
+   for (int32 i = 0; i < 4; i++)
+   {
+      if (i == largest)
+         continue;
+
+      const float normalized = FMath::Clamp(sign * components[i] / ROTATION_RANGE * 0.5f + 0.5f, 0.f, 1.f);
+      packed = (packed << ROTATION_BITS) | (uint64)FMath::RoundToInt(normalized * ROTATION_MASK);
+   }
+
+   return packed;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Restores a quantized rotation
+FQuat FJengaQuantizedTransform::DequantizeRotation(uint64 rotation)
+{
+   float components[4];
+   const int32 largest = (int32)(rotation >> (3 * ROTATION_BITS)) & 3;
+
+   float sumSquared = 0.f;
+   for (int32 i = 3; i >= 0; i--)
+   {
+      if (i == largest)
+         continue;
+
+      components[i] = ((float)(rotation & ROTATION_MASK) / ROTATION_MASK - 0.5f) * 2.f * ROTATION_RANGE;
+      sumSquared += components[i] * components[i];
+      rotation >>= ROTATION_BITS;
+   }
+   components[largest] = FMath::Sqrt(FMath::Max(0.f, 1.f - sumSquared));
+
+   return FQuat(components[0], components[1], components[2], components[3]).GetNormalized();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Serialization
+FArchive& operator<<(FArchive& ar, FJengaQuantizedTransform& transform)
+{
+   ar << transform.position.X << transform.position.Y << transform.position.Z;
+
+   // Only the lowest 6 bytes of the rotation are used
+   uint16 rotationWords[3] = {
+      (uint16)(transform.rotation >> 32),
+      (uint16)(transform.rotation >> 16),
+      (uint16)(transform.rotation)
+   };
+   ar << rotationWords[0] << rotationWords[1] << rotationWords[2];
+   transform.rotation = ((uint64)rotationWords[0] << 32) | ((uint64)rotationWords[1] << 16) | (uint64)rotationWords[2];
+
+   return ar;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Bit-packed serialization, for network packets
+void FJengaQuantizedTransform::NetSerialize(FArchive& ar)
+{
+   for (int32 i = 0; i < 3; i++)
+   {
+      uint32 packed = (uint32)FMath::Clamp(this->position[i] + NET_POSITION_OFFSET, 0, 2 * NET_POSITION_OFFSET - 1);
+      ar.SerializeBits(&packed, NET_POSITION_BITS);
+      this->position[i] = (int32)(packed & ((1u << NET_POSITION_BITS) - 1)) - NET_POSITION_OFFSET;
+   }
+
+   ar.SerializeBits(&this->rotation, ROTATION_PACKED_BITS);
+   this->rotation &= ((uint64)1 << ROTATION_PACKED_BITS) - 1;
+}
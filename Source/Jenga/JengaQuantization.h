@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* A block transform quantized for storage: positions are fixed point
+* multiples of POSITION_STEP, rotations are "smallest three" quaternions
+* (15 bits per component, plus 2 bits for the index of the dropped one).
+* Scale is not stored, blocks never change it.
+*/
+struct JENGA_API FJengaQuantizedTransform
+{
+   // Positions precision (cm)
+   static const float POSITION_STEP;
+
+   FIntVector position;
+   uint64 rotation;
+
+   FJengaQuantizedTransform() : position(0, 0, 0), rotation(0) {}
+   explicit FJengaQuantizedTransform(const FTransform& transform);
+
+   FTransform ToTransform() const;
+
+   // Positions and rotations on their own
+   static FIntVector QuantizePosition(const FVector& position);
+   static FVector DequantizePosition(const FIntVector& position);
+   static uint64 QuantizeRotation(const FQuat& rotation);
+   static FQuat DequantizeRotation(uint64 rotation);
+
+   bool operator==(const FJengaQuantizedTransform& other) const { return position == other.position && rotation == other.rotation; }
+   bool operator!=(const FJengaQuantizedTransform& other) const { return !(*this == other); }
+
+   // 12 bytes of position and 6 bytes of rotation
+   friend FArchive& operator<<(FArchive& ar, FJengaQuantizedTransform& transform);
+
+   // Bit-packed for network packets: 3x24 bits of position (up to 1.3 km from the origin) and 47 bits of rotation
+   void NetSerialize(FArchive& ar);
+};
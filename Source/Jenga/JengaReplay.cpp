@@ -0,0 +1,411 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaReplay.h"
+#include "Jenga.h"
+
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFilemanager.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Serialization/BufferReader.h"
+
+
+const uint32 FJengaReplayFormat::MAGIC = 0x524E474A; // "JGNR"
+const uint16 FJengaReplayFormat::VERSION = 1;
+
+typedef FJengaReplayFormat::FEvent FReplayEvent;
+
+
+///////////////////////////////////////////////////////////////////////////
+// Utility that serializes a quantized point
+inline void serializePoint(FArchive& ar, FIntVector& point)
+{
+   ar << point.X << point.Y << point.Z;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Utility that reads the body of a record (lastTarget is needed to decode target deltas)
+static bool readRecord(FArchive& ar, int32 nBlocks, FIntVector& lastTarget, FReplayEvent& event)
+{
+   if (ar.AtEnd())
+      return false;
+
+   uint8 type;
+   ar << type;
+   ar.SerializeIntPacked(event.steps);
+   event.type = (FJengaReplayFormat::RecordType)type;
+
+   FIntVector point;
+   switch (event.type)
+   {
+   case FJengaReplayFormat::NEW_GAME:
+      ar << event.seed << event.nPlayers;
+      break;
+
+   case FJengaReplayFormat::PICK:
+   {
+      uint32 blockIndex;
+      ar.SerializeIntPacked(blockIndex);
+      serializePoint(ar, point);
+      event.blockIndex = blockIndex;
+      event.point = FJengaQuantizedTransform::DequantizePosition(point);
+      lastTarget = point;
+      break;
+   }
+
+   case FJengaReplayFormat::TARGET:
+      serializePoint(ar, point);
+      event.point = FJengaQuantizedTransform::DequantizePosition(point);
+      lastTarget = point;
+      break;
+
+   case FJengaReplayFormat::TARGET_DELTA:
+   {
+      int16 delta[3];
+      ar << delta[0] << delta[1] << delta[2];
+      lastTarget += FIntVector(delta[0], delta[1], delta[2]);
+      event.point = FJengaQuantizedTransform::DequantizePosition(lastTarget);
+      event.type = FJengaReplayFormat::TARGET;
+      break;
+   }
+
+   case FJengaReplayFormat::TURN:
+   {
+      uint32 turn;
+      ar.SerializeIntPacked(turn);
+      event.turn = turn;
+      event.snapshot.SetNum(nBlocks);
+      for (int32 i = 0; i < nBlocks; i++)
+      {
+         FJengaQuantizedTransform transform;
+         ar << transform;
+         event.snapshot[i] = transform.ToTransform();
+      }
+      break;
+   }
+
+   case FJengaReplayFormat::BRANCH:
+   {
+      uint32 branch;
+      ar.SerializeIntPacked(branch);
+      event.branch = branch;
+      break;
+   }
+
+   case FJengaReplayFormat::END:
+      return false;
+
+   default:
+      break;
+   }
+
+   return !ar.IsError();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaReplayRecorder::FJengaReplayRecorder()
+{
+   stepDuration = 1.f / 60.f;
+   elapsed = 0.f;
+   lastStep = 0;
+   hasPendingTarget = false;
+   pendingTargetStep = 0;
+   pendingTarget = lastTarget = FIntVector(0, 0, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Destructor
+FJengaReplayRecorder::~FJengaReplayRecorder()
+{
+   Close();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Starts writing a file
+bool FJengaReplayRecorder::Open(const FString& path, int32 nBlocks, float stepDuration)
+{
+   Close();
+   this->file.Reset(IFileManager::Get().CreateFileWriter(*path));
+   if (!this->file)
+   {
+      UE_LOG(LogJenga, Error, TEXT("Replay: cannot write %s"), *path);
+      return false;
+   }
+
+   this->stepDuration = stepDuration;
+   this->elapsed = 0.f;
+   this->lastStep = 0;
+   this->hasPendingTarget = false;
+
+   uint32 magic = FJengaReplayFormat::MAGIC;
+   uint16 version = FJengaReplayFormat::VERSION;
+   *this->file << magic << version << nBlocks << stepDuration;
+
+   UE_LOG(LogJenga, Display, TEXT("Replay: recording to %s"), *path);
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Stops writing
+void FJengaReplayRecorder::Close()
+{
+   if (!this->file)
+      return;
+
+   FlushTarget();
+   WriteRecordHeader(FJengaReplayFormat::END, this->lastStep);
+   this->file->Close();
+   this->file.Reset();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Advances the recording clock
+void FJengaReplayRecorder::Advance(float deltaTime)
+{
+   this->elapsed += deltaTime;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A new game has started
+void FJengaReplayRecorder::RecordNewGame(int32 seed, int32 nPlayers)
+{
+   if (!IsRecording())
+      return;
+
+   FlushTarget();
+   WriteRecordHeader(FJengaReplayFormat::NEW_GAME, FMath::FloorToInt(this->elapsed / this->stepDuration));
+   *this->file << seed << nPlayers;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A block has been picked
+void FJengaReplayRecorder::RecordPick(int32 blockIndex, const FVector& grabPoint)
+{
+   if (!IsRecording())
+      return;
+
+   FlushTarget();
+   WriteRecordHeader(FJengaReplayFormat::PICK, FMath::FloorToInt(this->elapsed / this->stepDuration));
+   uint32 index = blockIndex;
+   this->file->SerializeIntPacked(index);
+   this->lastTarget = FJengaQuantizedTransform::QuantizePosition(grabPoint);
+   serializePoint(*this->file, this->lastTarget);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// The drag target has moved (only the last one of each step is written)
+void FJengaReplayRecorder::RecordTarget(const FVector& target)
+{
+   if (!IsRecording())
+      return;
+
+   const uint32 step = FMath::FloorToInt(this->elapsed / this->stepDuration);
+   if (this->hasPendingTarget && this->pendingTargetStep != step)
+      FlushTarget();
+
+   this->hasPendingTarget = true;
+   this->pendingTargetStep = step;
+   this->pendingTarget = FJengaQuantizedTransform::QuantizePosition(target);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// The picked block has been released
+void FJengaReplayRecorder::RecordRelease()
+{
+   if (!IsRecording())
+      return;
+
+   FlushTarget();
+   WriteRecordHeader(FJengaReplayFormat::RELEASE, FMath::FloorToInt(this->elapsed / this->stepDuration));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A turn has been undone
+void FJengaReplayRecorder::RecordUndo()
+{
+   if (!IsRecording())
+      return;
+
+   FlushTarget();
+   WriteRecordHeader(FJengaReplayFormat::UNDO, FMath::FloorToInt(this->elapsed / this->stepDuration));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A turn has been redone
+void FJengaReplayRecorder::RecordRedo()
+{
+   if (!IsRecording())
+      return;
+
+   FlushTarget();
+   WriteRecordHeader(FJengaReplayFormat::REDO, FMath::FloorToInt(this->elapsed / this->stepDuration));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Another branch of the current turn has been selected
+void FJengaReplayRecorder::RecordBranch(int32 branch)
+{
+   if (!IsRecording())
+      return;
+
+   FlushTarget();
+   WriteRecordHeader(FJengaReplayFormat::BRANCH, FMath::FloorToInt(this->elapsed / this->stepDuration));
+   uint32 branchIndex = FMath::Max(0, branch);
+   this->file->SerializeIntPacked(branchIndex);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A turn has started: saves the tower snapshot
+void FJengaReplayRecorder::RecordTurn(int32 turn, const TowerConfiguration& towerConf)
+{
+   if (!IsRecording())
+      return;
+
+   FlushTarget();
+   WriteRecordHeader(FJengaReplayFormat::TURN, FMath::FloorToInt(this->elapsed / this->stepDuration));
+   uint32 turnNumber = FMath::Max(0, turn);
+   this->file->SerializeIntPacked(turnNumber);
+   for (const auto& transform : towerConf)
+   {
+      FJengaQuantizedTransform quantized(transform);
+      *this->file << quantized;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Writes the type of a record and the steps elapsed since the previous one
+void FJengaReplayRecorder::WriteRecordHeader(FJengaReplayFormat::RecordType type, uint32 step)
+{
+   uint8 recordType = type;
+   uint32 steps = step - FMath::Min(step, this->lastStep);
+   *this->file << recordType;
+   this->file->SerializeIntPacked(steps);
+   this->lastStep = FMath::Max(step, this->lastStep);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Writes the last drag target (as a delta, if it's small enough)
+void FJengaReplayRecorder::FlushTarget()
+{
+   if (!this->hasPendingTarget)
+      return;
+
+   this->hasPendingTarget = false;
+   const FIntVector delta = this->pendingTarget - this->lastTarget;
+   const bool fitsInt16 = FMath::Abs(delta.X) <= MAX_int16 && FMath::Abs(delta.Y) <= MAX_int16 && FMath::Abs(delta.Z) <= MAX_int16;
+
+   if (fitsInt16)
+   {
+      WriteRecordHeader(FJengaReplayFormat::TARGET_DELTA, this->pendingTargetStep);
+      int16 deltas[3] = { (int16)delta.X, (int16)delta.Y, (int16)delta.Z };
+      *this->file << deltas[0] << deltas[1] << deltas[2];
+   }
+   else
+   {
+      WriteRecordHeader(FJengaReplayFormat::TARGET, this->pendingTargetStep);
+      serializePoint(*this->file, this->pendingTarget);
+   }
+   this->lastTarget = this->pendingTarget;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaReplayPlayer::FJengaReplayPlayer()
+{
+   mappedFile = nullptr;
+   mappedRegion = nullptr;
+   nBlocks = 0;
+   stepDuration = 1.f / 60.f;
+   lastTarget = FIntVector(0, 0, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Destructor
+FJengaReplayPlayer::~FJengaReplayPlayer()
+{
+   Close();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Maps a replay file and indexes its turns
+bool FJengaReplayPlayer::Open(const FString& path)
+{
+   Close();
+
+   this->mappedFile = FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*path);
+   this->mappedRegion = this->mappedFile ? this->mappedFile->MapRegion() : nullptr;
+   if (!this->mappedRegion)
+   {
+      UE_LOG(LogJenga, Error, TEXT("Replay: cannot map %s"), *path);
+      Close();
+      return false;
+   }
+
+   uint8* data = const_cast<uint8*>(this->mappedRegion->GetMappedPtr());
+   this->reader.Reset(new FBufferReader(data, this->mappedRegion->GetMappedSize(), false));
+
+   // Header
+   uint32 magic = 0;
+   uint16 version = 0;
+   *this->reader << magic << version << this->nBlocks << this->stepDuration;
+   if (magic != FJengaReplayFormat::MAGIC || version != FJengaReplayFormat::VERSION || this->reader->IsError())
+   {
+      UE_LOG(LogJenga, Error, TEXT("Replay: %s is not a valid replay (version %d)"), *path, version);
+      Close();
+      return false;
+   }
+
+   // Index the turns
+   const int64 firstRecord = this->reader->Tell();
+   int64 newGameOffset = firstRecord;
+   int64 offset = firstRecord;
+   FReplayEvent event;
+   while (readRecord(*this->reader, this->nBlocks, this->lastTarget, event))
+   {
+      if (event.type == FJengaReplayFormat::NEW_GAME)
+         newGameOffset = offset;
+      else if (event.type == FJengaReplayFormat::TURN)
+         this->turnIndex.Add({ event.turn, offset, newGameOffset });
+      offset = this->reader->Tell();
+   }
+
+   this->reader->Seek(firstRecord);
+   UE_LOG(LogJenga, Display, TEXT("Replay: %s opened, %d turns"), *path, this->turnIndex.Num());
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Unmaps the file
+void FJengaReplayPlayer::Close()
+{
+   this->reader.Reset();
+   this->turnIndex.Reset();
+
+   delete this->mappedRegion;
+   this->mappedRegion = nullptr;
+   delete this->mappedFile;
+   this->mappedFile = nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Reads the next record
+bool FJengaReplayPlayer::Next(FReplayEvent& outEvent)
+{
+   return this->reader && readRecord(*this->reader, this->nBlocks, this->lastTarget, outEvent);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Moves right after the first snapshot of the given turn
+bool FJengaReplayPlayer::SeekToTurn(int32 turn, FReplayEvent& outNewGame, FReplayEvent& outTurn)
+{
+   const FTurnIndexEntry* entry = this->turnIndex.FindByPredicate([turn](const FTurnIndexEntry& e) { return e.turn == turn; });
+   if (!entry || !this->reader)
+      return false;
+
+   this->reader->Seek(entry->newGameOffset);
+   if (!Next(outNewGame) || outNewGame.type != FJengaReplayFormat::NEW_GAME)
+      return false;
+
+   this->reader->Seek(entry->offset);
+   return Next(outTurn);
+}
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "JengaBlockRegistry.h"
+#include "JengaQuantization.h"
+
+class FArchive;
+class FBufferReader;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/**
+* Replay file format. After the header, the file is a stream of records:
+* a record type, the number of steps since the previous record (packed) and the record's payload.
+* Drag targets are stored as deltas from the previous one whenever they fit in 16 bits.
+*/
+struct JENGA_API FJengaReplayFormat
+{
+   static const uint32 MAGIC;
+   static const uint16 VERSION;
+
+   enum RecordType : uint8 { NEW_GAME, PICK, TARGET, TARGET_DELTA, RELEASE, UNDO, REDO, TURN, END, BRANCH };
+
+   // A decoded record
+   struct FEvent
+   {
+      RecordType type;
+      uint32 steps;
+      int32 seed, nPlayers, turn;
+      int32 blockIndex;
+      int32 branch;
+      FVector point;
+      TowerConfiguration snapshot;
+   };
+};
+
+/**
+* Records a game: new game seeds, picks, releases, undos/redos/branch switches, the drag target
+* stream (at most one sample per step) and a tower snapshot at the beginning of every turn.
+*/
+class JENGA_API FJengaReplayRecorder
+{
+public:
+   FJengaReplayRecorder();
+   ~FJengaReplayRecorder();
+
+   // Starts/stops writing a file
+   bool Open(const FString& path, int32 nBlocks, float stepDuration);
+   void Close();
+   bool IsRecording() const { return file != nullptr; }
+
+   // Advances the recording clock
+   void Advance(float deltaTime);
+
+   void RecordNewGame(int32 seed, int32 nPlayers);
+   void RecordPick(int32 blockIndex, const FVector& grabPoint);
+   void RecordTarget(const FVector& target);
+   void RecordRelease();
+   void RecordUndo();
+   void RecordRedo();
+   void RecordBranch(int32 branch);
+   void RecordTurn(int32 turn, const TowerConfiguration& towerConf);
+
+private:
+   void WriteRecordHeader(FJengaReplayFormat::RecordType type, uint32 step);
+   void FlushTarget();
+
+   TUniquePtr<FArchive> file;
+   float stepDuration, elapsed;
+   uint32 lastStep;
+
+   // Only the last target of each step is saved
+   bool hasPendingTarget;
+   uint32 pendingTargetStep;
+   FIntVector pendingTarget, lastTarget;
+};
+
+/**
+* Reads a replay file through a memory mapping: an index of the turn snapshots
+* is built when opening, so that playback can start from any turn.
+*/
+class JENGA_API FJengaReplayPlayer
+{
+public:
+   FJengaReplayPlayer();
+   ~FJengaReplayPlayer();
+
+   bool Open(const FString& path);
+   void Close();
+
+   // Reads the next record (false at the end of the file)
+   bool Next(FJengaReplayFormat::FEvent& outEvent);
+
+   // Moves right after the first snapshot of the given turn, returning it with its game's record
+   bool SeekToTurn(int32 turn, FJengaReplayFormat::FEvent& outNewGame, FJengaReplayFormat::FEvent& outTurn);
+
+   int32 GetNumBlocks() const { return nBlocks; }
+   float GetStepDuration() const { return stepDuration; }
+   int32 GetNumTurns() const { return turnIndex.Num(); }
+
+private:
+   struct FTurnIndexEntry
+   {
+      int32 turn;
+      int64 offset, newGameOffset;
+   };
+
+   IMappedFileHandle* mappedFile;
+   IMappedFileRegion* mappedRegion;
+   TUniquePtr<FBufferReader> reader;
+   TArray<FTurnIndexEntry> turnIndex;
+
+   int32 nBlocks;
+   float stepDuration;
+   FIntVector lastTarget;
+};
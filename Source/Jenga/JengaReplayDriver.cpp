@@ -0,0 +1,239 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaReplayDriver.h"
+#include "Jenga.h"
+#include "JengaGameMode.h"
+#include "JengaTowerSession.h"
+#include "JengaPlayerController.h"
+
+#include "Engine/World.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "HAL/PlatformTime.h"
+#include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
+
+
+// A block further than this (cm) from its recorded position means the replay diverged
+static const float DIVERGENCE_TOLERANCE = 0.5f;
+
+// How long (simulated seconds) we wait for the tower to reach a recorded turn
+static const float TURN_TIMEOUT = 30.f;
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+AJengaReplayDriver::AJengaReplayDriver()
+{
+   PrimaryActorTick.bCanEverTick = true;
+   PrimaryActorTick.bStartWithTickEnabled = true;
+
+   session = nullptr;
+   controller = nullptr;
+   stepsToWait = 0;
+   waitingTurn = false;
+   waitingTime = 0.f;
+   checkedTurns = divergedTurns = 0;
+   replayedSteps = 0;
+   startSeconds = 0.0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Has a replay been requested from command line?
+bool AJengaReplayDriver::IsRequested()
+{
+   FString path;
+   return FParse::Value(FCommandLine::Get(), TEXT("JengaReplay="), path);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called when the game starts or when spawned
+void AJengaReplayDriver::BeginPlay()
+{
+   Super::BeginPlay();
+
+   FString path;
+   FParse::Value(FCommandLine::Get(), TEXT("JengaReplay="), path);
+
+   AJengaGameMode* gameMode = Cast<AJengaGameMode>(GetWorld()->GetAuthGameMode());
+   this->session = gameMode ? gameMode->GetSessions()[0] : nullptr;
+   this->controller = Cast<AJengaPlayerController>(GetWorld()->GetFirstPlayerController());
+   if (!this->session || !this->controller || !this->player.Open(path))
+   {
+      SetActorTickEnabled(false);
+      return;
+   }
+
+   if (this->player.GetNumBlocks() != this->session->GetBlocks().Num())
+   {
+      UE_LOG(LogJenga, Error, TEXT("Replay: recorded with %d blocks, the tower has %d"), this->player.GetNumBlocks(), this->session->GetBlocks().Num());
+      SetActorTickEnabled(false);
+      return;
+   }
+   this->controller->SetScripted(true);
+
+   // Start from a given turn?
+   int32 fromTurn = 0;
+   if (FParse::Value(FCommandLine::Get(), TEXT("JengaReplayFrom="), fromTurn) && fromTurn > 0)
+   {
+      FJengaReplayFormat::FEvent newGame, turn;
+      if (this->player.SeekToTurn(fromTurn, newGame, turn))
+      {
+         this->session->NewGame(newGame.nPlayers, newGame.seed);
+         this->session->RestoreTurn(turn.turn, turn.snapshot);
+      }
+      else
+         UE_LOG(LogJenga, Warning, TEXT("Replay: turn %d not found, starting from the beginning"), fromTurn);
+   }
+
+   // Play as fast as possible, with the recording time step
+   FApp::SetBenchmarking(true);
+   FApp::SetUseFixedTimeStep(true);
+   FApp::SetFixedDeltaTime(this->player.GetStepDuration());
+
+   this->startSeconds = FPlatformTime::Seconds();
+   if (this->player.Next(this->nextEvent))
+      this->stepsToWait = this->nextEvent.steps;
+   else
+      Finish();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called every frame (one recorded step)
+void AJengaReplayDriver::Tick(float deltaTime)
+{
+   Super::Tick(deltaTime);
+
+   // The recording is paused until the tower reaches the recorded turn
+   if (this->waitingTurn)
+   {
+      this->waitingTime += deltaTime;
+      CheckTurn();
+      if (this->waitingTurn)
+         return;
+   }
+
+   this->replayedSteps++;
+   if (this->stepsToWait > 0)
+   {
+      this->stepsToWait--;
+      return;
+   }
+
+   // Apply all the events of this step
+   do
+   {
+      Apply(this->nextEvent);
+      if (!this->player.Next(this->nextEvent))
+      {
+         Finish();
+         return;
+      }
+   } while (this->nextEvent.steps == 0 && !this->waitingTurn);
+
+   this->stepsToWait = this->nextEvent.steps > 0 ? this->nextEvent.steps - 1 : 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Applies a recorded event
+void AJengaReplayDriver::Apply(const FJengaReplayFormat::FEvent& event)
+{
+   switch (event.type)
+   {
+   case FJengaReplayFormat::NEW_GAME:
+      this->controller->ReleaseBlock();
+      this->session->NewGame(event.nPlayers, event.seed);
+      break;
+
+   case FJengaReplayFormat::PICK:
+      this->controller->PickBlock(this->session->GetBlockRegistry().GetMesh(event.blockIndex), event.point);
+      break;
+
+   case FJengaReplayFormat::TARGET:
+      this->controller->DragTo(event.point);
+      break;
+
+   case FJengaReplayFormat::RELEASE:
+      this->controller->ReleaseBlock();
+      break;
+
+   case FJengaReplayFormat::UNDO:
+      this->session->Undo();
+      break;
+
+   case FJengaReplayFormat::REDO:
+      this->session->Redo();
+      break;
+
+   case FJengaReplayFormat::BRANCH:
+      this->session->SwitchBranch(event.branch);
+      break;
+
+   case FJengaReplayFormat::TURN:
+      this->expectedTurn = event;
+      this->waitingTurn = true;
+      this->waitingTime = 0.f;
+      CheckTurn();
+      break;
+
+   default:
+      break;
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Compares the tower with the recorded snapshot, once it reaches the recorded turn
+void AJengaReplayDriver::CheckTurn()
+{
+   const bool reached = this->session->GetTurn() == this->expectedTurn.turn;
+   if (!reached && this->waitingTime < TURN_TIMEOUT)
+      return;
+
+   this->waitingTurn = false;
+   this->checkedTurns++;
+
+   if (!reached)
+   {
+      // Resynchronize, so that the rest of the replay still makes sense
+      this->divergedTurns++;
+      UE_LOG(LogJenga, Warning, TEXT("Replay: turn %d never reached (tower is at turn %d)"), this->expectedTurn.turn, this->session->GetTurn());
+      this->controller->ReleaseBlock();
+      this->session->RestoreTurn(this->expectedTurn.turn, this->expectedTurn.snapshot);
+      return;
+   }
+
+   // Find the block that went furthest from its recorded position
+   const FJengaBlockRegistry& blocks = this->session->GetBlockRegistry();
+   float maxError = 0.f;
+   int32 maxErrorBlock = INDEX_NONE;
+   for (int32 i = 0; i < blocks.Num(); i++)
+   {
+      const float error = FVector::Dist(blocks.GetBlock(i)->GetActorLocation(), this->expectedTurn.snapshot[i].GetLocation());
+      if (error > maxError)
+      {
+         maxError = error;
+         maxErrorBlock = i;
+      }
+   }
+
+   if (maxError > DIVERGENCE_TOLERANCE)
+   {
+      this->divergedTurns++;
+      UE_LOG(LogJenga, Warning, TEXT("Replay: turn %d diverged, block %d is %.2f cm away from its recorded position"),
+         this->expectedTurn.turn, maxErrorBlock, maxError);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Logs the replay results
+void AJengaReplayDriver::Finish()
+{
+   const double wallSeconds = FPlatformTime::Seconds() - this->startSeconds;
+   const double replayedSeconds = this->replayedSteps * this->player.GetStepDuration();
+   UE_LOG(LogJenga, Display, TEXT("Replay: %d turns checked, %d diverged, %.2f s replayed in %.2f s (%.1fx real time)"),
+      this->checkedTurns, this->divergedTurns, replayedSeconds, wallSeconds, replayedSeconds / FMath::Max(wallSeconds, 1e-6));
+
+   this->player.Close();
+   SetActorTickEnabled(false);
+   FPlatformMisc::RequestExit(false);
+}
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "JengaReplay.h"
+#include "JengaReplayDriver.generated.h"
+
+class AJengaPlayerController;
+class UJengaTowerSession;
+
+/**
+* Plays back a recorded game on the player's tower (-JengaReplay=<file>, optionally -JengaReplayFrom=<turn>).
+* It runs with a fixed step, as fast as possible, and reports every turn whose
+* tower doesn't match the recorded snapshot.
+*/
+UCLASS()
+class JENGA_API AJengaReplayDriver : public AActor
+{
+   GENERATED_BODY()
+
+public:
+   // Constructor
+   AJengaReplayDriver();
+
+   // Has a replay been requested from command line?
+   static bool IsRequested();
+
+protected:
+   // Called when the game starts or when spawned
+   virtual void BeginPlay() override;
+
+   // Called every frame
+   virtual void Tick(float deltaTime) override;
+
+private:
+   void Apply(const FJengaReplayFormat::FEvent& event);
+   void CheckTurn();
+   void Finish();
+
+   UJengaTowerSession* session;
+   AJengaPlayerController* controller;
+   FJengaReplayPlayer player;
+
+   // Next event to apply and steps to wait before it
+   FJengaReplayFormat::FEvent nextEvent;
+   uint32 stepsToWait;
+
+   // Recorded snapshot the tower must reach
+   FJengaReplayFormat::FEvent expectedTurn;
+   bool waitingTurn;
+   float waitingTime;
+
+   // Statistics
+   int32 checkedTurns, divergedTurns;
+   uint32 replayedSteps;
+   double startSeconds;
+};
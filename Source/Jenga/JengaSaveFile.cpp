@@ -0,0 +1,199 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaSaveFile.h"
+#include "Jenga.h"
+#include "JengaQuantization.h"
+
+#include "Misc/FileHelper.h"
+
+
+const uint32 FJengaSaveFile::MAGIC = 0x5653474A; // "JGSV"
+const uint16 FJengaSaveFile::VERSION = 2;
+
+// Positions precision gets worse than this (cm) only for blocks spread over more than 65 m
+static const float MAX_POSITION_STEP = 0.1f;
+
+
+// On-disk layout (little endian, no padding)
+#pragma pack(push, 1)
+struct FJengaSaveHeader
+{
+   uint32 magic;
+   uint16 version;
+   uint16 reserved;
+   int32 nBlocks;
+   int32 nConfigurations;
+   int32 nPlayers;
+   int32 turn;
+   int32 moves;
+   int32 seed;
+   int32 firstTurn;
+   int32 current;
+   float origin[3];
+   float positionStep;
+};
+
+struct FJengaPackedTransform
+{
+   uint16 position[3];
+   uint16 rotation[3];
+};
+#pragma pack(pop)
+
+
+///////////////////////////////////////////////////////////////////////////
+// Utility that packs a transform
+inline FJengaPackedTransform packTransform(const FTransform& transform, const FVector& origin, float positionStep)
+{
+   FJengaPackedTransform packed;
+   const FVector position = (transform.GetLocation() - origin) / positionStep;
+   for (int32 i = 0; i < 3; i++)
+      packed.position[i] = (uint16)FMath::Clamp(FMath::RoundToInt(position[i]), 0, (int32)MAX_uint16);
+
+   const uint64 rotation = FJengaQuantizedTransform::QuantizeRotation(transform.GetRotation());
+   packed.rotation[0] = (uint16)(rotation >> 32);
+   packed.rotation[1] = (uint16)(rotation >> 16);
+   packed.rotation[2] = (uint16)rotation;
+   return packed;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Utility that unpacks a transform
+inline FTransform unpackTransform(const FJengaPackedTransform& packed, const FVector& origin, float positionStep)
+{
+   const FVector position = origin + FVector(packed.position[0], packed.position[1], packed.position[2]) * positionStep;
+   const uint64 rotation = ((uint64)packed.rotation[0] << 32) | ((uint64)packed.rotation[1] << 16) | (uint64)packed.rotation[2];
+   return FTransform(FJengaQuantizedTransform::DequantizeRotation(rotation), position);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Writes a game in memory
+void FJengaSaveFile::Write(const FJengaSavedGame& game, TArray<uint8>& outData)
+{
+   // All the configurations share the same quantization box
+   TArray<const TowerConfiguration*> configurations;
+   configurations.Add(&game.defaultConfiguration);
+   for (const auto& towerConf : game.turns)
+      configurations.Add(&towerConf);
+
+   FBox box(ForceInit);
+   for (const auto& towerConf : configurations)
+      for (const auto& transform : *towerConf)
+         box += transform.GetLocation();
+   if (!box.IsValid)
+      box = FBox(FVector::ZeroVector, FVector::ZeroVector);
+
+   const float extent = box.GetSize().GetMax();
+   const float positionStep = FMath::Max(FJengaQuantizedTransform::POSITION_STEP, extent / MAX_uint16);
+   if (positionStep > MAX_POSITION_STEP)
+      UE_LOG(LogJenga, Warning, TEXT("Save: blocks are spread over %.0f cm, positions precision is %.2f cm"), extent, positionStep);
+
+   const int32 nBlocks = game.defaultConfiguration.Num();
+   FJengaSaveHeader header;
+   FMemory::Memzero(header);
+   header.magic = MAGIC;
+   header.version = VERSION;
+   header.nBlocks = nBlocks;
+   header.nConfigurations = configurations.Num();
+   header.nPlayers = game.nPlayers;
+   header.turn = game.turn;
+   header.moves = game.moves;
+   header.seed = game.seed;
+   header.firstTurn = game.firstTurn;
+   header.current = game.current;
+   header.origin[0] = box.Min.X;
+   header.origin[1] = box.Min.Y;
+   header.origin[2] = box.Min.Z;
+   header.positionStep = positionStep;
+
+   check(game.parents.Num() == game.turns.Num());
+   const int32 parentsSize = game.parents.Num() * sizeof(int32);
+   outData.SetNumUninitialized(sizeof(FJengaSaveHeader) + parentsSize + configurations.Num() * nBlocks * sizeof(FJengaPackedTransform));
+   FMemory::Memcpy(outData.GetData(), &header, sizeof(FJengaSaveHeader));
+   FMemory::Memcpy(outData.GetData() + sizeof(FJengaSaveHeader), game.parents.GetData(), parentsSize);
+
+   FJengaPackedTransform* packed = (FJengaPackedTransform*)(outData.GetData() + sizeof(FJengaSaveHeader) + parentsSize);
+   for (const auto& towerConf : configurations)
+   {
+      check(towerConf->Num() == nBlocks);
+      for (const auto& transform : *towerConf)
+         *packed++ = packTransform(transform, box.Min, positionStep);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Reads a game from memory
+bool FJengaSaveFile::Read(const TArray<uint8>& data, FJengaSavedGame& outGame)
+{
+   if (data.Num() < (int32)sizeof(FJengaSaveHeader))
+      return false;
+
+   FJengaSaveHeader header;
+   FMemory::Memcpy(&header, data.GetData(), sizeof(FJengaSaveHeader));
+   if (header.magic != MAGIC || header.version != VERSION || header.nConfigurations < 2 || header.nBlocks < 0)
+      return false;
+
+   const int32 nTurns = header.nConfigurations - 1;
+   const int64 expectedSize = sizeof(FJengaSaveHeader) + (int64)nTurns * sizeof(int32) + (int64)header.nConfigurations * header.nBlocks * sizeof(FJengaPackedTransform);
+   if (data.Num() != expectedSize || header.current < 0 || header.current >= nTurns || header.nPlayers < 1)
+      return false;
+
+   // Parents always come before their children
+   outGame.parents.SetNumUninitialized(nTurns);
+   FMemory::Memcpy(outGame.parents.GetData(), data.GetData() + sizeof(FJengaSaveHeader), nTurns * sizeof(int32));
+   TArray<int32> depths;
+   depths.SetNumUninitialized(nTurns);
+   int32 maxDepth = 0;
+   for (int32 i = 0; i < nTurns; i++)
+   {
+      if (outGame.parents[i] >= i || outGame.parents[i] < INDEX_NONE || (outGame.parents[i] == INDEX_NONE) != (i == 0))
+         return false;
+      depths[i] = i == 0 ? 0 : depths[outGame.parents[i]] + 1;
+      maxDepth = FMath::Max(maxDepth, depths[i]);
+   }
+
+   // Turns played can't go past the last turn of the history
+   if (header.moves < header.firstTurn || header.moves > header.firstTurn + maxDepth)
+      return false;
+
+   outGame.nPlayers = header.nPlayers;
+   outGame.turn = header.turn;
+   outGame.moves = header.moves;
+   outGame.seed = header.seed;
+   outGame.firstTurn = header.firstTurn;
+   outGame.current = header.current;
+
+   const FVector origin(header.origin[0], header.origin[1], header.origin[2]);
+   const FJengaPackedTransform* packed = (const FJengaPackedTransform*)(data.GetData() + sizeof(FJengaSaveHeader) + nTurns * sizeof(int32));
+
+   outGame.defaultConfiguration.SetNumUninitialized(header.nBlocks);
+   for (int32 i = 0; i < header.nBlocks; i++)
+      outGame.defaultConfiguration[i] = unpackTransform(*packed++, origin, header.positionStep);
+
+   outGame.turns.SetNum(nTurns);
+   for (auto& towerConf : outGame.turns)
+   {
+      towerConf.SetNumUninitialized(header.nBlocks);
+      for (int32 i = 0; i < header.nBlocks; i++)
+         towerConf[i] = unpackTransform(*packed++, origin, header.positionStep);
+   }
+
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Saves a game to file
+bool FJengaSaveFile::Save(const FString& path, const FJengaSavedGame& game)
+{
+   TArray<uint8> data;
+   Write(game, data);
+   return FFileHelper::SaveArrayToFile(data, *path);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Loads a game from file
+bool FJengaSaveFile::Load(const FString& path, FJengaSavedGame& outGame)
+{
+   TArray<uint8> data;
+   return FFileHelper::LoadFileToArray(data, *path) && Read(data, outGame);
+}
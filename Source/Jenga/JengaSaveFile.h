@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "JengaBlockRegistry.h"
+
+// Everything needed to restore a game
+struct JENGA_API FJengaSavedGame
+{
+   int32 nPlayers;
+   int32 turn, moves;
+   int32 seed;
+   int32 firstTurn;
+   TowerConfiguration defaultConfiguration;
+
+   // The history tree: every turn's parent comes before it (INDEX_NONE for the first turn)
+   TArray<TowerConfiguration> turns;
+   TArray<int32> parents;
+   int32 current;
+
+   FJengaSavedGame() : nPlayers(1), turn(0), moves(0), seed(0), firstTurn(0), current(0) {}
+};
+
+/**
+* Compact binary save of a game: a fixed size header, the parent of every saved turn
+* and the packed transforms of every saved configuration (12 bytes per block: positions are
+* 16 bit fixed point values relative to the bounding box of all the blocks,
+* rotations are smallest three quaternions). Loading is a single read and a copy.
+*/
+class JENGA_API FJengaSaveFile
+{
+public:
+   static const uint32 MAGIC;
+   static const uint16 VERSION;
+
+   // In memory
+   static void Write(const FJengaSavedGame& game, TArray<uint8>& outData);
+   static bool Read(const TArray<uint8>& data, FJengaSavedGame& outGame);
+
+   // On file
+   static bool Save(const FString& path, const FJengaSavedGame& game);
+   static bool Load(const FString& path, FJengaSavedGame& outGame);
+};
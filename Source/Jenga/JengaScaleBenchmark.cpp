@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaScaleBenchmark.h"
+#include "Jenga.h"
+#include "JengaGameMode.h"
+#include "JengaTowerSession.h"
+#include "JengaTowerGenerator.h"
+
+#include "Engine/World.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "HAL/PlatformTime.h"
+
+
+// Benchmarked towers (number of layers, with 3 blocks each)
+static const int32 BENCHMARK_LAYERS[] = { 18, 180, 1800 };
+static const int32 BENCHMARK_BLOCKS_PER_LAYER = 3;
+
+// Every measure is the average of this number of turns
+static const int32 BENCHMARK_ITERATIONS = 20;
+
+// Benchmarked towers are built this far from the level's one (they are destroyed before physics can move them)
+static const FVector BENCHMARK_OFFSET = FVector(100000.f, 0.f, 0.f);
+
+
+///////////////////////////////////////////////////////////////////////////
+// Has a benchmark been requested from command line?
+bool AJengaScaleBenchmark::IsRequested()
+{
+   return FParse::Param(FCommandLine::Get(), TEXT("JengaScaleBenchmark"));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called when the game starts or when spawned
+void AJengaScaleBenchmark::BeginPlay()
+{
+   Super::BeginPlay();
+
+   AJengaGameMode* gameMode = Cast<AJengaGameMode>(GetWorld()->GetAuthGameMode());
+   if (!gameMode || gameMode->GetSessions().Num() == 0)
+   {
+      UE_LOG(LogJenga, Error, TEXT("Scale benchmark: cannot find the Jenga game mode"));
+      return;
+   }
+
+   // Every benchmarked tower is a copy of the level's bottom blocks
+   const UJengaTowerSession* levelSession = gameMode->GetSessions()[0];
+   AActor* templateBlock = FJengaTowerGenerator::FindTemplate(levelSession->GetBlocks());
+   const FVector towerCenter = levelSession->GetTowerCenter();
+
+   UE_LOG(LogJenga, Display, TEXT("Scale benchmark: average ms per turn over %d turns"), BENCHMARK_ITERATIONS);
+   UE_LOG(LogJenga, Display, TEXT("%8s %10s %10s %14s %10s %10s %10s %10s"),
+      TEXT("blocks"), TEXT("snapshot"), TEXT("apply"), TEXT("interactivity"), TEXT("stability"), TEXT("total"), TEXT("undo"), TEXT("spawn"));
+
+   for (const int32 nLayers : BENCHMARK_LAYERS)
+   {
+      const double spawnStart = FPlatformTime::Seconds();
+      TowerConfiguration towerConf = FJengaTowerGenerator::MakeConfiguration(
+         templateBlock, towerCenter, nLayers, BENCHMARK_BLOCKS_PER_LAYER, UJengaTowerSession::GetBlockSizes());
+      for (auto& transform : towerConf)
+         transform.AddToTranslation(BENCHMARK_OFFSET);
+
+      TArray<AActor*> blocks;
+      FJengaTowerGenerator::Spawn(templateBlock, towerConf, blocks);
+
+      UJengaTowerSession* session = NewObject<UJengaTowerSession>(this);
+      session->Init(blocks, 16, 0, false);
+      session->NewGame(1, 0);
+      const double spawnMs = (FPlatformTime::Seconds() - spawnStart) * 1000.0;
+
+      const FJengaTurnCosts costs = session->MeasureTurnCosts(BENCHMARK_ITERATIONS);
+      UE_LOG(LogJenga, Display, TEXT("%8d %10.3f %10.3f %14.3f %10.3f %10.3f %10.3f %10.1f"),
+         blocks.Num(), costs.snapshotMs, costs.applyMs, costs.interactivityMs, costs.stabilityMs,
+         costs.snapshotMs + costs.applyMs + costs.interactivityMs + costs.stabilityMs, costs.undoMs, spawnMs);
+
+      for (const auto& jengaBlock : blocks)
+         jengaBlock->Destroy();
+   }
+
+   FPlatformMisc::RequestExit(false);
+}
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "JengaScaleBenchmark.generated.h"
+
+/**
+* Measures how the per-turn game logic scales with the tower's size.
+* Spawned by the game mode when the game is launched with -JengaScaleBenchmark
+* (it works with -nullrhi): towers of 54, 540 and 5400 blocks are generated
+* next to the level's one, timed, destroyed, and the results are logged.
+*/
+UCLASS()
+class JENGA_API AJengaScaleBenchmark : public AActor
+{
+   GENERATED_BODY()
+
+public:
+   // Has a benchmark been requested from command line?
+   static bool IsRequested();
+
+protected:
+   // Called when the game starts or when spawned
+   virtual void BeginPlay() override;
+};
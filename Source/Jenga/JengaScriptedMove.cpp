@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaScriptedMove.h"
+
+
+static const float PULL_SPEED = 20.f;
+static const float MOVE_SPEED = 60.f;
+
+
+///////////////////////////////////////////////////////////////////////////
+// Plans a move that pulls a block out of the tower and puts it on top
+FJengaScriptedMove FJengaScriptedMove::PullAndPlace(
+   const FVector& grabPoint,
+   const FVector& blockAxis,
+   const FVector& towerCenter,
+   float pullDistance,
+   const FVector& placement,
+   float liftHeight)
+{
+   // Pull the block away from the tower's center
+   FVector pullDir = FVector(blockAxis.X, blockAxis.Y, 0.f).GetSafeNormal();
+   if (FVector::DotProduct(grabPoint - towerCenter, pullDir) < 0.f)
+      pullDir = -pullDir;
+   const FVector pulled = grabPoint + pullDir * pullDistance;
+
+   // Lift it over the tower, then lower it on top
+   const float liftZ = FMath::Max(pulled.Z, placement.Z) + liftHeight;
+
+   FJengaScriptedMove move;
+   move.AddWaypoint(grabPoint, PULL_SPEED);
+   move.AddWaypoint(pulled, PULL_SPEED);
+   move.AddWaypoint(FVector(pulled.X, pulled.Y, liftZ), MOVE_SPEED);
+   move.AddWaypoint(FVector(placement.X, placement.Y, liftZ), MOVE_SPEED);
+   move.AddWaypoint(placement, PULL_SPEED);
+   return move;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Adds a waypoint reached moving at the given speed from the previous one
+void FJengaScriptedMove::AddWaypoint(const FVector& waypoint, float speed)
+{
+   const float time = this->waypoints.Num() > 0
+      ? this->times.Last() + FVector::Dist(this->waypoints.Last(), waypoint) / FMath::Max(speed, KINDA_SMALL_NUMBER)
+      : 0.f;
+
+   this->waypoints.Add(waypoint);
+   this->times.Add(time);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Drag target at a given time since the beginning of the move
+FVector FJengaScriptedMove::Evaluate(float time) const
+{
+   if (this->waypoints.Num() == 0)
+      return FVector::ZeroVector;
+
+   for (int32 i = 1; i < this->waypoints.Num(); i++)
+   {
+      if (time < this->times[i])
+      {
+         const float alpha = (time - this->times[i - 1]) / FMath::Max(this->times[i] - this->times[i - 1], KINDA_SMALL_NUMBER);
+         return FMath::Lerp(this->waypoints[i - 1], this->waypoints[i], FMath::Clamp(alpha, 0.f, 1.f));
+      }
+   }
+
+   return this->waypoints.Last();
+}
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* A drag path made of waypoints travelled at constant speed.
+* Used by scripted players to drive the pick/drag/release flow without a mouse.
+*/
+class JENGA_API FJengaScriptedMove
+{
+public:
+   // Plans a move that pulls a block out of the tower along its long axis and puts it on top
+   static FJengaScriptedMove PullAndPlace(
+      const FVector& grabPoint,
+      const FVector& blockAxis,
+      const FVector& towerCenter,
+      float pullDistance,
+      const FVector& placement,
+      float liftHeight
+   );
+
+   // Adds a waypoint reached moving at the given speed (cm/s) from the previous one
+   void AddWaypoint(const FVector& waypoint, float speed);
+
+   // Drag target at a given time since the beginning of the move
+   FVector Evaluate(float time) const;
+   float GetDuration() const { return times.Num() > 0 ? times.Last() : 0.f; }
+   bool IsFinished(float time) const { return time >= GetDuration(); }
+
+private:
+   TArray<FVector> waypoints;
+   TArray<float> times;
+};
@@ -0,0 +1,343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaSimulationDriver.h"
+#include "Jenga.h"
+#include "JengaStats.h"
+#include "JengaGameMode.h"
+#include "JengaTowerSession.h"
+#include "JengaPlayerController.h"
+
+#include "Engine/World.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformTime.h"
+#include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
+
+
+// Simulation time step (seconds)
+static const float SIMULATION_STEP = 1.f / 60.f;
+
+// A turn that takes longer than this (simulated seconds) is considered stuck
+static const float TURN_TIMEOUT = 30.f;
+
+// How far a block is pulled out of the tower, beyond its length
+static const float PULL_MARGIN = 5.f;
+
+// Benchmark results are only comparable on this map
+static const TCHAR* const BENCHMARK_MAP = TEXT("MainScene");
+
+// Frames not sampled by the benchmark while the level settles
+static const int32 BENCHMARK_WARMUP_FRAMES = 30;
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+AJengaSimulationDriver::AJengaSimulationDriver()
+{
+   PrimaryActorTick.bCanEverTick = true;
+   PrimaryActorTick.bStartWithTickEnabled = true;
+
+   gameMode = nullptr;
+   targetTurns = 0;
+   simulatedTurns = attempts = collapses = timeouts = 0;
+   frames = idleTowers = 0;
+   startSeconds = maxTurnSeconds = 0.0;
+
+   benchmark = false;
+   seed = 0;
+   lastFrameSeconds = 0.0;
+   physicsSamples = turnLatencySamples = 0;
+   benchmarkTurns = 200;
+   benchmarkSeed = 42;
+   frameBudgetMs = gameThreadBudgetMs = physicsBudgetMs = turnLatencyBudgetMs = 0.f;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Has a simulation been requested from command line?
+bool AJengaSimulationDriver::IsRequested()
+{
+   int32 turns = 0;
+   FString resultsPath;
+   return (FParse::Value(FCommandLine::Get(), TEXT("JengaSimulate="), turns) && turns > 0) || IsBenchmarkRequested(resultsPath);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Has a benchmark been requested from command line? (-JengaBenchmark or -JengaBenchmark=<results file>)
+bool AJengaSimulationDriver::IsBenchmarkRequested(FString& outResultsPath)
+{
+   if (FParse::Value(FCommandLine::Get(), TEXT("JengaBenchmark="), outResultsPath))
+      return true;
+
+   outResultsPath = FPaths::ProjectSavedDir() / TEXT("Jenga") / TEXT("Benchmark.json");
+   return FParse::Param(FCommandLine::Get(), TEXT("JengaBenchmark"));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called when the game starts or when spawned
+void AJengaSimulationDriver::BeginPlay()
+{
+   Super::BeginPlay();
+
+   // A benchmark has its own turns and seed, unless they are given
+   this->benchmark = IsBenchmarkRequested(this->benchmarkResultsPath);
+   if (this->benchmark)
+   {
+      this->targetTurns = this->benchmarkTurns;
+      this->seed = this->benchmarkSeed;
+   }
+   FParse::Value(FCommandLine::Get(), TEXT("JengaSimulate="), this->targetTurns);
+   FParse::Value(FCommandLine::Get(), TEXT("JengaSeed="), this->seed);
+   this->random.Initialize(this->seed);
+
+   this->gameMode = Cast<AJengaGameMode>(GetWorld()->GetAuthGameMode());
+   if (!this->gameMode)
+   {
+      UE_LOG(LogJenga, Error, TEXT("Simulation: cannot find the Jenga game mode"));
+      SetActorTickEnabled(false);
+      return;
+   }
+
+   // Only the first towers are played (-JengaActiveTowers=N), the other ones stay idle
+   const TArray<UJengaTowerSession*>& sessions = this->gameMode->GetSessions();
+   int32 activeTowers = sessions.Num();
+   FParse::Value(FCommandLine::Get(), TEXT("JengaActiveTowers="), activeTowers);
+   this->idleTowers = sessions.Num() - FMath::Clamp(activeTowers, 1, sessions.Num());
+
+   // The player's controller plays the first tower, the other ones (and all of them on a dedicated server) get their own controller
+   AJengaPlayerController* playerController = Cast<AJengaPlayerController>(GetWorld()->GetFirstPlayerController());
+   for (int32 i = 0; i < sessions.Num() - this->idleTowers; i++)
+   {
+      FLane lane;
+      lane.session = sessions[i];
+      lane.controller = i == 0 && playerController ? playerController : GetWorld()->SpawnActor<AJengaPlayerController>();
+      lane.controller->SetScripted(true);
+      lane.state = FLane::WAITING;
+      lane.turnTime = 0.f;
+      lane.turnAtStart = 0;
+      lane.turnStartSeconds = 0.0;
+      this->lanes.Add(lane);
+   }
+
+   // The whole run only depends on the seed: games start from seeded towers
+   for (auto& lane : this->lanes)
+      lane.session->NewGame(lane.session->GetNumberOfPlayers(), this->random.RandHelper(MAX_int32));
+
+   // Run as fast as possible, with a fixed time step
+   FApp::SetBenchmarking(true);
+   FApp::SetUseFixedTimeStep(true);
+   FApp::SetFixedDeltaTime(SIMULATION_STEP);
+
+   UE_LOG(LogJenga, Display, TEXT("Simulation: playing %d turns on %d tower(s), %d idle (seed %d)"), this->targetTurns, this->lanes.Num(), this->idleTowers, this->seed);
+   if (this->benchmark && GetWorld()->GetMapName() != BENCHMARK_MAP)
+      UE_LOG(LogJenga, Warning, TEXT("Benchmark: running on %s, results are only comparable on %s"), *GetWorld()->GetMapName(), BENCHMARK_MAP);
+
+#if CSV_PROFILER
+   // Export the Jenga stats of the whole simulation (Saved/Profiling/CSV)
+   if (FParse::Param(FCommandLine::Get(), TEXT("JengaCsv")))
+      FCsvProfiler::Get()->BeginCapture();
+#endif
+   this->startSeconds = this->lastFrameSeconds = FPlatformTime::Seconds();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called every frame
+void AJengaSimulationDriver::Tick(float deltaTime)
+{
+   Super::Tick(deltaTime);
+   this->frames++;
+   if (this->benchmark)
+      SampleFrame();
+
+   for (auto& lane : this->lanes)
+      TickLane(lane, deltaTime);
+
+   if (this->simulatedTurns >= this->targetTurns)
+   {
+      Report();
+      const bool passed = !this->benchmark || ReportBenchmark();
+#if CSV_PROFILER
+      if (FCsvProfiler::Get()->IsCapturing())
+         FCsvProfiler::Get()->EndCapture();
+#endif
+      SetActorTickEnabled(false);
+      if (passed)
+         FPlatformMisc::RequestExit(false);
+      else
+      {
+         // A forced exit after a critical error returns a non zero code, failing CI jobs
+         GLog->Flush();
+         GIsCriticalError = true;
+         FPlatformMisc::RequestExit(true);
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Plays a tower
+void AJengaSimulationDriver::TickLane(FLane& lane, float deltaTime)
+{
+   if (lane.state == FLane::WAITING)
+   {
+      StartTurn(lane);
+      return;
+   }
+
+   lane.turnTime += deltaTime;
+   if (lane.session->IsGameOver())
+      EndTurn(lane, COLLAPSED);
+   else if (lane.turnTime > TURN_TIMEOUT)
+      EndTurn(lane, TIMED_OUT);
+
+   else if (lane.state == FLane::DRAGGING)
+   {
+      lane.controller->DragTo(lane.move.Evaluate(lane.turnTime));
+      if (lane.move.IsFinished(lane.turnTime))
+      {
+         lane.controller->ReleaseBlock();
+         lane.state = FLane::SETTLING;
+      }
+   }
+
+   else if (lane.session->GetTurn() != lane.turnAtStart)
+      EndTurn(lane, PLAYED);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Picks a random block and plans its move
+void AJengaSimulationDriver::StartTurn(FLane& lane)
+{
+   TArray<AActor*> interactiveBlocks;
+   lane.session->GetInteractiveBlocks(interactiveBlocks);
+   if (interactiveBlocks.Num() == 0)
+   {
+      lane.session->NewGame(lane.session->GetNumberOfPlayers(), this->random.RandHelper(MAX_int32));
+      return;
+   }
+
+   AActor* block = interactiveBlocks[this->random.RandHelper(interactiveBlocks.Num())];
+   UStaticMeshComponent* mesh = block->FindComponentByClass<UStaticMeshComponent>();
+   const FVector grabPoint = mesh->Bounds.Origin;
+   const FVector& blockSizes = UJengaTowerSession::GetBlockSizes();
+
+   lane.move = FJengaScriptedMove::PullAndPlace(
+      grabPoint,
+      mesh->GetForwardVector(),
+      lane.session->GetTowerCenter(),
+      blockSizes.X + PULL_MARGIN,
+      lane.session->GetTopPlacement(),
+      2.f * blockSizes.Z
+   );
+
+   lane.turnAtStart = lane.session->GetTurn();
+   lane.turnTime = 0.f;
+   lane.turnStartSeconds = FPlatformTime::Seconds();
+   lane.state = lane.controller->PickBlock(mesh, grabPoint) ? FLane::DRAGGING : FLane::WAITING;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Collects the result of a turn
+void AJengaSimulationDriver::EndTurn(FLane& lane, TurnResult result)
+{
+   lane.controller->ReleaseBlock();
+   lane.state = FLane::WAITING;
+
+   this->attempts++;
+   this->maxTurnSeconds = FMath::Max(this->maxTurnSeconds, FPlatformTime::Seconds() - lane.turnStartSeconds);
+   if (result == PLAYED)
+      this->simulatedTurns++;
+   else
+   {
+      // Collapsed or stuck (counted apart, a stuck turn says nothing about the tower): start again
+      if (result == COLLAPSED)
+         this->collapses++;
+      else
+         this->timeouts++;
+      lane.session->NewGame(lane.session->GetNumberOfPlayers(), this->random.RandHelper(MAX_int32));
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Logs the simulation results
+void AJengaSimulationDriver::Report()
+{
+   const double wallSeconds = FPlatformTime::Seconds() - this->startSeconds;
+   const double turnsPerSecond = this->simulatedTurns / FMath::Max(wallSeconds, 1e-6);
+   UE_LOG(LogJenga, Display, TEXT("Simulation: %d turns, %d attempts, %d collapses, %d timeouts in %.2f s on %d tower(s)"),
+      this->simulatedTurns, this->attempts, this->collapses, this->timeouts, wallSeconds, this->lanes.Num());
+   UE_LOG(LogJenga, Display, TEXT("Simulation: %.2f turns/s (%.2f per tower), collapse rate %.1f%%, timeout rate %.1f%%, %.2f ms/turn (max %.2f ms)"),
+      turnsPerSecond,
+      turnsPerSecond / FMath::Max(this->lanes.Num(), 1),
+      100.0 * this->collapses / FMath::Max(this->attempts, 1),
+      100.0 * this->timeouts / FMath::Max(this->attempts, 1),
+      1000.0 * wallSeconds / FMath::Max(this->attempts, 1),
+      1000.0 * this->maxTurnSeconds);
+
+   // Matches one core can host in real time: a frame must fit in a simulation step
+   const double frameMs = 1000.0 * wallSeconds / FMath::Max(this->frames, 1);
+   const double towers = this->lanes.Num() + this->idleTowers;
+   UE_LOG(LogJenga, Display, TEXT("Simulation: %d frames, %.3f ms/frame, capacity %.1f matches per core (%d active, %d idle)"),
+      this->frames, frameMs, towers * 1000.0 * SIMULATION_STEP / FMath::Max(frameMs, 1e-6), this->lanes.Num(), this->idleTowers);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Samples the timings of the last frame
+void AJengaSimulationDriver::SampleFrame()
+{
+   const double now = FPlatformTime::Seconds();
+   const double frameMs = 1000.0 * (now - this->lastFrameSeconds);
+   this->lastFrameSeconds = now;
+
+   // Physics steps and turns of the player's tower, as timed by the game mode
+   const FJengaPerfCounters& counters = this->gameMode->GetPerfCounters();
+   const uint32 newPhysicsSamples = counters.GetSamplesCount(FJengaPerfCounters::PHYSICS_STEP);
+   const double physicsMs = newPhysicsSamples != this->physicsSamples ? counters.GetLastSample(FJengaPerfCounters::PHYSICS_STEP) : 0.0;
+   this->physicsSamples = newPhysicsSamples;
+
+   const uint32 newTurnLatencySamples = counters.GetSamplesCount(FJengaPerfCounters::TURN_LATENCY);
+   if (newTurnLatencySamples != this->turnLatencySamples)
+      this->benchmarkResults.Add(FJengaBenchmarkResults::TURN_LATENCY, counters.GetLastSample(FJengaPerfCounters::TURN_LATENCY));
+   this->turnLatencySamples = newTurnLatencySamples;
+
+   if (this->frames <= BENCHMARK_WARMUP_FRAMES)
+      return;
+
+   // Without a renderer, what the game thread doesn't spend waiting for physics is its own work
+   this->benchmarkResults.Add(FJengaBenchmarkResults::FRAME, frameMs);
+   this->benchmarkResults.Add(FJengaBenchmarkResults::PHYSICS, physicsMs);
+   this->benchmarkResults.Add(FJengaBenchmarkResults::GAME_THREAD, FMath::Max(0.0, frameMs - physicsMs));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Logs and saves the benchmark results, returns whether they are within budget
+bool AJengaSimulationDriver::ReportBenchmark()
+{
+   const FJengaBenchmarkResults::FBudgets budgets = { this->frameBudgetMs, this->gameThreadBudgetMs, this->physicsBudgetMs, this->turnLatencyBudgetMs };
+
+   UE_LOG(LogJenga, Display, TEXT("Benchmark: %12s %8s %8s %8s %8s %8s %8s %10s"),
+      TEXT("ms"), TEXT("samples"), TEXT("avg"), TEXT("p50"), TEXT("p95"), TEXT("p99"), TEXT("max"), TEXT("budget"));
+   for (int32 i = 0; i < FJengaBenchmarkResults::METRICS_COUNT; i++)
+   {
+      const FJengaBenchmarkResults::Metric metric = (FJengaBenchmarkResults::Metric)i;
+      const FJengaBenchmarkResults::FSummary summary = this->benchmarkResults.Summarize(metric);
+      UE_LOG(LogJenga, Display, TEXT("Benchmark: %12s %8d %8.3f %8.3f %8.3f %8.3f %8.3f %10.3f"),
+         FJengaBenchmarkResults::GetName(metric), summary.count, summary.average, summary.p50, summary.p95, summary.p99, summary.max, budgets[i]);
+   }
+
+   TArray<FString> failures;
+   const bool passed = this->benchmarkResults.CheckBudgets(budgets, failures);
+   for (const auto& failure : failures)
+      UE_LOG(LogJenga, Error, TEXT("Benchmark: over budget: %s"), *failure);
+
+   if (this->benchmarkResults.Save(this->benchmarkResultsPath, GetWorld()->GetMapName(), this->seed, this->simulatedTurns, budgets, passed))
+      UE_LOG(LogJenga, Display, TEXT("Benchmark: results written to %s"), *this->benchmarkResultsPath);
+   else
+      UE_LOG(LogJenga, Error, TEXT("Benchmark: cannot write %s"), *this->benchmarkResultsPath);
+
+   if (passed)
+      UE_LOG(LogJenga, Display, TEXT("Benchmark: passed"));
+   else
+      UE_LOG(LogJenga, Error, TEXT("Benchmark: failed"));
+   return passed;
+}
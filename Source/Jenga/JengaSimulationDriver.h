@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "JengaScriptedMove.h"
+#include "JengaBenchmarkResults.h"
+#include "JengaSimulationDriver.generated.h"
+
+class AJengaGameMode;
+class AJengaPlayerController;
+class UJengaTowerSession;
+
+/**
+* Plays scripted Jenga turns without any user input, as fast as possible.
+* Spawned by the game mode when the game is launched with -JengaSimulate=<turns>
+* (it works with -nullrhi), and reports throughput, collapse rate and stuck turns at the end.
+* Every tower hosted by the game mode is played at the same time, each one by its own controller
+* (also on a dedicated server, where it reports how many matches a core can host).
+* With -JengaBenchmark[=<results file>] it plays a fixed seeded script, samples frame, game thread,
+* physics and turn latency timings, writes their percentiles and fails if they are over budget.
+*/
+UCLASS(Config=Game)
+class JENGA_API AJengaSimulationDriver : public AActor
+{
+   GENERATED_BODY()
+
+public:
+   // Constructor
+   AJengaSimulationDriver();
+
+   // Has a simulation (or a benchmark) been requested from command line?
+   static bool IsRequested();
+   static bool IsBenchmarkRequested(FString& outResultsPath);
+
+protected:
+   // Called when the game starts or when spawned
+   virtual void BeginPlay() override;
+
+   // Called every frame
+   virtual void Tick(float deltaTime) override;
+
+private:
+   // A tower being played
+   struct FLane
+   {
+      UJengaTowerSession* session;
+      AJengaPlayerController* controller;
+
+      enum DriverState { WAITING, DRAGGING, SETTLING };
+      DriverState state;
+      FJengaScriptedMove move;
+      float turnTime;
+      int turnAtStart;
+      double turnStartSeconds;
+   };
+
+   void TickLane(FLane& lane, float deltaTime);
+   void StartTurn(FLane& lane);
+   enum TurnResult { PLAYED, COLLAPSED, TIMED_OUT };
+   void EndTurn(FLane& lane, TurnResult result);
+   void Report();
+
+   // Benchmark
+   void SampleFrame();
+   bool ReportBenchmark();
+
+   AJengaGameMode* gameMode;
+   TArray<FLane> lanes;
+   FRandomStream random;
+
+   // Statistics
+   int32 targetTurns;
+   int32 simulatedTurns, attempts, collapses, timeouts;
+   int32 frames, idleTowers;
+   double startSeconds, maxTurnSeconds;
+
+   // Benchmark
+   bool benchmark;
+   FString benchmarkResultsPath;
+   FJengaBenchmarkResults benchmarkResults;
+   int32 seed;
+   double lastFrameSeconds;
+   uint32 physicsSamples, turnLatencySamples;
+
+   // Turns played by the benchmark (overridden by -JengaSimulate=N) and its script's seed (overridden by -JengaSeed=N)
+   UPROPERTY(Config) int32 benchmarkTurns;
+   UPROPERTY(Config) int32 benchmarkSeed;
+   // Budgets of the 95th percentiles (ms, 0 means no budget)
+   UPROPERTY(Config) float frameBudgetMs;
+   UPROPERTY(Config) float gameThreadBudgetMs;
+   UPROPERTY(Config) float physicsBudgetMs;
+   UPROPERTY(Config) float turnLatencyBudgetMs;
+};
@@ -0,0 +1,252 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaStabilityAnalyzer.h"
+
+
+// Blocks tilted more than this (cosine of the angle) don't lie flat: their contacts can't be predicted
+static const float MAX_TILT_COSINE = 0.996f;
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaStabilityAnalyzer::FJengaStabilityAnalyzer()
+{
+   this->blockSizes = FVector(75.f, 25.f, 15.f);
+   this->margin = 1.f;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets the blocks' sizes and the prediction margin
+void FJengaStabilityAnalyzer::Configure(const FVector& blockSizes, float margin)
+{
+   this->blockSizes = blockSizes;
+   this->margin = margin;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Predicts the future of a tower
+FJengaStabilityAnalyzer::Prediction FJengaStabilityAnalyzer::Analyze(const TArray<FTransform>& blocks) const
+{
+   const float distance = GetSupportDistance(blocks);
+   if (distance > this->margin)
+      return STABLE;
+   if (distance < -this->margin)
+      return COLLAPSING;
+   return UNCERTAIN;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Distance of the weakest centre of mass from the border of its support
+float FJengaStabilityAnalyzer::GetSupportDistance(
+   const TArray<FTransform>& blocks,
+   int32 movedBlock,
+   const FTransform& movedPose,
+   bool movedBlockHeld) const
+{
+   if (blocks.Num() == 0)
+      return MAX_FLT;
+
+   // Bucket blocks by layer (the lowest block is on the floor)
+   auto getPose = [&](int32 i) -> const FTransform& { return i == movedBlock ? movedPose : blocks[i]; };
+   float baseZ = MAX_FLT;
+   for (int32 i = 0; i < blocks.Num(); i++)
+   {
+      if (getPose(i).GetRotation().GetAxisZ().Z < MAX_TILT_COSINE)
+         return 0.f;
+      baseZ = FMath::Min(baseZ, getPose(i).GetLocation().Z);
+   }
+
+   TArray<TArray<int32>> layers;
+   TArray<Polygon> footprints;
+   footprints.SetNum(blocks.Num());
+   for (int32 i = 0; i < blocks.Num(); i++)
+   {
+      const int32 layer = FMath::RoundToInt((getPose(i).GetLocation().Z - baseZ) / this->blockSizes.Z);
+      if (layer >= layers.Num())
+         layers.SetNum(layer + 1);
+      layers[layer].Add(i);
+      GetFootprint(getPose(i), footprints[i]);
+   }
+
+   // A block above an empty layer is in the air (e.g. just released): can't tell
+   for (int32 layer = 1; layer < layers.Num(); layer++)
+      if (layers[layer - 1].Num() == 0 && layers[layer].ContainsByPredicate([&](int32 i) { return i != movedBlock || !movedBlockHeld; }))
+         return 0.f;
+
+   // From the top down: each block must stand on the layer below, and so must everything above each layer
+   float distance = MAX_FLT;
+   FVector2D stackCenter = FVector2D::ZeroVector;
+   int32 stackBlocks = 0;
+   TArray<FVector2D> stackContacts, blockContacts;
+   Polygon contact;
+
+   // Blocks with something resting on them are clamped by the layers above: only their stack must stand
+   TBitArray<> covered(false, blocks.Num());
+
+   for (int32 layer = layers.Num() - 1; layer > 0; layer--)
+   {
+      stackContacts.Reset();
+      for (const int32 upper : layers[layer])
+      {
+         // A held block doesn't weigh on the tower
+         if (upper == movedBlock && movedBlockHeld)
+            continue;
+
+         blockContacts.Reset();
+         for (const int32 lower : layers[layer - 1])
+         {
+            Clip(footprints[upper], footprints[lower], contact);
+            blockContacts.Append(contact.GetData(), contact.Num());
+            if (contact.Num() > 0)
+               covered[lower] = true;
+         }
+
+         // Nothing below: can't tell (it's not resting on the tower yet)
+         if (blockContacts.Num() == 0)
+            return 0.f;
+
+         const FVector2D center(getPose(upper).GetLocation());
+         if (!covered[upper])
+            distance = FMath::Min(distance, GetSupportDistance(blockContacts, center));
+         if (distance < -this->margin)
+            return distance;
+
+         stackContacts.Append(blockContacts);
+         stackCenter += center;
+         stackBlocks++;
+      }
+
+      if (stackBlocks > 0)
+      {
+         distance = FMath::Min(distance, GetSupportDistance(stackContacts, stackCenter / stackBlocks));
+         if (distance < -this->margin)
+            return distance;
+      }
+   }
+
+   return distance;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Area of the contact between a block and one below it
+float FJengaStabilityAnalyzer::GetContactArea(const FTransform& upper, const FTransform& lower) const
+{
+   Polygon upperFootprint, lowerFootprint, contact;
+   GetFootprint(upper, upperFootprint);
+   GetFootprint(lower, lowerFootprint);
+   Clip(upperFootprint, lowerFootprint, contact);
+
+   // Shoelace formula (the contact is counterclockwise)
+   float area = 0.f;
+   for (int32 i = 0; i < contact.Num(); i++)
+      area += contact[i] ^ contact[(i + 1) % contact.Num()];
+   return FMath::Max(0.f, area / 2.f);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the rectangle covered by a block on the XY plane (counterclockwise)
+void FJengaStabilityAnalyzer::GetFootprint(const FTransform& block, Polygon& outFootprint) const
+{
+   const FVector2D center(block.GetLocation());
+   const FVector2D axisX = FVector2D(block.GetRotation().GetAxisX()) * (this->blockSizes.X / 2.f);
+   const FVector2D axisY = FVector2D(block.GetRotation().GetAxisY()) * (this->blockSizes.Y / 2.f);
+
+   outFootprint.Reset();
+   outFootprint.Add(center + axisX + axisY);
+   outFootprint.Add(center - axisX + axisY);
+   outFootprint.Add(center - axisX - axisY);
+   outFootprint.Add(center + axisX - axisY);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Distance of a centre of mass from the border of the convex hull of its contacts
+float FJengaStabilityAnalyzer::GetSupportDistance(const TArray<FVector2D>& contacts, const FVector2D& centerOfMass)
+{
+   // Nothing below: can't tell (the block may be in the air)
+   if (contacts.Num() == 0)
+      return 0.f;
+
+   // Edge or corner contacts: can't tell
+   Polygon hull;
+   ConvexHull(contacts, hull);
+   if (hull.Num() < 3)
+      return 0.f;
+
+   return SignedDistance(hull, centerOfMass);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Intersection of two convex polygons (Sutherland-Hodgman, counterclockwise)
+void FJengaStabilityAnalyzer::Clip(const Polygon& subject, const Polygon& clip, Polygon& outPolygon)
+{
+   outPolygon = subject;
+   Polygon input;
+   for (int32 e = 0; e < clip.Num() && outPolygon.Num() > 0; e++)
+   {
+      const FVector2D& a = clip[e];
+      const FVector2D edge = clip[(e + 1) % clip.Num()] - a;
+
+      input = outPolygon;
+      outPolygon.Reset();
+      for (int32 i = 0; i < input.Num(); i++)
+      {
+         const FVector2D& prev = input[(i + input.Num() - 1) % input.Num()];
+         const FVector2D& cur = input[i];
+         const float prevSide = edge ^ (prev - a);
+         const float curSide = edge ^ (cur - a);
+
+         if ((prevSide >= 0.f) != (curSide >= 0.f))
+            outPolygon.Add(prev + (cur - prev) * (prevSide / (prevSide - curSide)));
+         if (curSide >= 0.f)
+            outPolygon.Add(cur);
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Convex hull of a set of points (Andrew's monotone chain, counterclockwise)
+void FJengaStabilityAnalyzer::ConvexHull(TArray<FVector2D> points, Polygon& outHull)
+{
+   points.Sort([](const FVector2D& a, const FVector2D& b) { return a.X < b.X || (a.X == b.X && a.Y < b.Y); });
+
+   outHull.Reset();
+   if (points.Num() < 3)
+   {
+      outHull.Append(points.GetData(), points.Num());
+      return;
+   }
+
+   outHull.SetNum(2 * points.Num());
+   int32 k = 0;
+
+   // Lower hull, then upper hull
+   for (int32 i = 0; i < points.Num(); i++)
+   {
+      while (k >= 2 && ((outHull[k - 1] - outHull[k - 2]) ^ (points[i] - outHull[k - 2])) <= 0.f)
+         k--;
+      outHull[k++] = points[i];
+   }
+   for (int32 i = points.Num() - 2, lower = k + 1; i >= 0; i--)
+   {
+      while (k >= lower && ((outHull[k - 1] - outHull[k - 2]) ^ (points[i] - outHull[k - 2])) <= 0.f)
+         k--;
+      outHull[k++] = points[i];
+   }
+
+   // The last point is the first one
+   outHull.SetNum(k - 1, false);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Distance of a point from the border of a convex polygon (positive inside)
+float FJengaStabilityAnalyzer::SignedDistance(const Polygon& hull, const FVector2D& point)
+{
+   float distance = MAX_FLT;
+   for (int32 i = 0; i < hull.Num(); i++)
+   {
+      const FVector2D& a = hull[i];
+      const FVector2D edge = (hull[(i + 1) % hull.Num()] - a).GetSafeNormal();
+      distance = FMath::Min(distance, edge ^ (point - a));
+   }
+   return distance;
+}
@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+* Predicts whether a tower will stand or fall from the poses of its blocks only,
+* without waiting for physics: every block, and every stack of layers, must have
+* its centre of mass over the polygon of its contacts with the layer below.
+* Only clear-cut cases (farther than a margin from the support border) are predicted.
+*/
+class JENGA_API FJengaStabilityAnalyzer
+{
+public:
+   enum Prediction { STABLE, COLLAPSING, UNCERTAIN };
+
+   FJengaStabilityAnalyzer();
+
+   // Sets the blocks' sizes and how far from the support border a centre of mass must be to be sure
+   void Configure(const FVector& blockSizes, float margin);
+
+   // Predicts the future of a tower, given the transforms of its blocks' centres (thread safe)
+   Prediction Analyze(const TArray<FTransform>& blocks) const;
+
+   // Distance of the weakest centre of mass from the border of its support (negative outside,
+   // 0 when it can't be told: tilted blocks, blocks with nothing below, gaps between layers).
+   // Blocks with others resting on them are clamped: only the stacks they belong to are checked.
+   // A block can be moved elsewhere: when held, it supports the blocks above but doesn't need
+   // any support itself. Stops at the first certain collapse. (thread safe)
+   float GetSupportDistance(
+      const TArray<FTransform>& blocks,
+      int32 movedBlock = INDEX_NONE,
+      const FTransform& movedPose = FTransform::Identity,
+      bool movedBlockHeld = false
+   ) const;
+
+   // Area of the contact between a block and one below it, on the XY plane (thread safe)
+   float GetContactArea(const FTransform& upper, const FTransform& lower) const;
+
+private:
+   typedef TArray<FVector2D, TInlineAllocator<8>> Polygon;
+
+   void GetFootprint(const FTransform& block, Polygon& outFootprint) const;
+   static float GetSupportDistance(const TArray<FVector2D>& contacts, const FVector2D& centerOfMass);
+
+   static void Clip(const Polygon& subject, const Polygon& clip, Polygon& outPolygon);
+   static void ConvexHull(TArray<FVector2D> points, Polygon& outHull);
+   static float SignedDistance(const Polygon& hull, const FVector2D& point);
+
+   FVector blockSizes;
+   float margin;
+};
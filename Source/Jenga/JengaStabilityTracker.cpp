@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaStabilityTracker.h"
+#include "JengaBlockRegistry.h"
+
+#include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaStabilityTracker::FJengaStabilityTracker()
+{
+   this->blocks = nullptr;
+   this->speedThresholdSquared = 0.f;
+   this->settleTime = 0.f;
+   this->restTime = 0.f;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets the rest conditions
+void FJengaStabilityTracker::Configure(float speedThreshold, float settleTime)
+{
+   this->speedThresholdSquared = speedThreshold * speedThreshold;
+   this->settleTime = settleTime;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Enables wake events on the registered blocks and reads their current state
+void FJengaStabilityTracker::Init(const FJengaBlockRegistry& blocks)
+{
+   this->blocks = &blocks;
+   for (int32 i = 0; i < blocks.Num(); i++)
+   {
+      UStaticMeshComponent* mesh = blocks.GetMesh(i);
+      if (!mesh->BodyInstance.bGenerateWakeEvents)
+      {
+         mesh->BodyInstance.bGenerateWakeEvents = true;
+         mesh->RecreatePhysicsState();
+      }
+   }
+
+   Sync();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Reads again the state of all the bodies
+void FJengaStabilityTracker::Sync()
+{
+   // Blocks have been teleported: all of them may have moved (sized first, OnWake reads the flags)
+   this->wokenBlocks.Reset();
+   this->wokenFlags.Init(true, this->blocks->Num());
+   for (int32 i = 0; i < this->blocks->Num(); i++)
+      this->wokenBlocks.Add(i);
+
+   this->awakeBlocks.Reset();
+   this->awakeSlots.Init(INDEX_NONE, this->blocks->Num());
+   for (int32 i = 0; i < this->blocks->Num(); i++)
+      if (this->blocks->GetMesh(i)->RigidBodyIsAwake())
+         OnWake(i);
+
+   this->restTime = 0.f;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A block woke up
+void FJengaStabilityTracker::OnWake(int32 index)
+{
+   if (this->awakeSlots.IsValidIndex(index) && this->awakeSlots[index] == INDEX_NONE)
+   {
+      this->awakeSlots[index] = this->awakeBlocks.Add(index);
+      this->restTime = 0.f;
+
+      if (!this->wokenFlags[index])
+      {
+         this->wokenFlags[index] = true;
+         this->wokenBlocks.Add(index);
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A block fell asleep
+void FJengaStabilityTracker::OnSleep(int32 index)
+{
+   if (!this->awakeSlots.IsValidIndex(index) || this->awakeSlots[index] == INDEX_NONE)
+      return;
+
+   // Swap with the last awake block
+   const int32 slot = this->awakeSlots[index];
+   this->awakeBlocks.RemoveAtSwap(slot, 1, false);
+   if (slot < this->awakeBlocks.Num())
+      this->awakeSlots[this->awakeBlocks[slot]] = slot;
+   this->awakeSlots[index] = INDEX_NONE;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Checks the awake blocks and updates the rest timer
+void FJengaStabilityTracker::Update(float deltaTime)
+{
+   for (const int32 index : this->awakeBlocks)
+   {
+      if (this->blocks->GetMesh(index)->GetPhysicsLinearVelocity().SizeSquared() > this->speedThresholdSquared)
+      {
+         this->restTime = 0.f;
+         return;
+      }
+   }
+
+   this->restTime += deltaTime;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Are all the awake blocks slower than the given speed?
+bool FJengaStabilityTracker::AreAwakeBlocksSlowerThan(float speed) const
+{
+   for (const int32 index : this->awakeBlocks)
+      if (this->blocks->GetMesh(index)->GetPhysicsLinearVelocity().SizeSquared() > speed * speed)
+         return false;
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the blocks that woke up since the last call
+void FJengaStabilityTracker::ConsumeWokenBlocks(TArray<int32>& outBlocks)
+{
+   outBlocks = MoveTemp(this->wokenBlocks);
+   this->wokenBlocks.Reset();
+   for (const int32 index : outBlocks)
+      this->wokenFlags[index] = false;
+
+   // Blocks still awake will keep moving
+   for (const int32 index : this->awakeBlocks)
+   {
+      this->wokenFlags[index] = true;
+      this->wokenBlocks.Add(index);
+   }
+}
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FJengaBlockRegistry;
+
+/**
+* Tracks which blocks are awake, using the rigid bodies' wake/sleep notifications.
+* Only awake blocks get their speed checked, and the tower is considered at rest
+* once they all stay slow for a given amount of time (not frames).
+*/
+class JENGA_API FJengaStabilityTracker
+{
+public:
+   FJengaStabilityTracker();
+
+   // Sets the speed under which a block is considered still, and for how long the tower must be still
+   void Configure(float speedThreshold, float settleTime);
+
+   // Enables wake events on the registered blocks and reads their current state
+   void Init(const FJengaBlockRegistry& blocks);
+
+   // Reads again the state of all the bodies (call after teleporting blocks)
+   void Sync();
+
+   // Wake/sleep notifications
+   void OnWake(int32 index);
+   void OnSleep(int32 index);
+
+   // Checks the awake blocks and updates the rest timer
+   void Update(float deltaTime);
+
+   // Restarts the rest timer
+   void ResetRestTime() { restTime = 0.f; }
+
+   // Is the tower at rest?
+   bool IsSettled() const { return awakeBlocks.Num() == 0 || restTime >= settleTime; }
+
+   // Are all the awake blocks slower than the given speed?
+   bool AreAwakeBlocksSlowerThan(float speed) const;
+
+   int32 GetAwakeCount() const { return awakeBlocks.Num(); }
+   const TArray<int32>& GetAwakeBlocks() const { return awakeBlocks; }
+
+   // Returns the blocks that woke up since the last call (they are the only ones that may have moved)
+   void ConsumeWokenBlocks(TArray<int32>& outBlocks);
+
+private:
+   const FJengaBlockRegistry* blocks;
+
+   // Awake blocks, and the position of each block in that array (for O(1) removal)
+   TArray<int32> awakeBlocks;
+   TArray<int32> awakeSlots;
+
+   // Blocks woken up since the last ConsumeWokenBlocks
+   TArray<int32> wokenBlocks;
+   TBitArray<> wokenFlags;
+
+   float speedThresholdSquared;
+   float settleTime;
+   float restTime;
+};
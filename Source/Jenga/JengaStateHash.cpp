@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaStateHash.h"
+#include "JengaQuantization.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Utility that scrambles 64 bits (splitmix64 finalizer)
+inline uint64 mix(uint64 x)
+{
+   x += 0x9E3779B97F4A7C15ull;
+   x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+   x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+   return x ^ (x >> 31);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Hash of a single block
+uint64 FJengaStateHash::HashBlock(const FTransform& transform)
+{
+   const FJengaQuantizedTransform quantized(transform);
+   uint64 hash = mix((uint64)(uint32)quantized.position.X | ((uint64)(uint32)quantized.position.Y << 32));
+   hash = mix(hash ^ (uint64)(uint32)quantized.position.Z);
+   return mix(hash ^ quantized.rotation);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Hash of all the blocks of a configuration
+uint64 FJengaStateHash::HashConfiguration(const TowerConfiguration& towerConf)
+{
+   uint64 hash = 0;
+   for (const auto& transform : towerConf)
+      hash += HashBlock(transform);
+   return hash;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Mixes the game state into the hash of the blocks
+uint64 FJengaStateHash::Combine(uint64 blocksHash, int32 turn, int32 player, uint8 status)
+{
+   const uint64 gameState = (uint64)(uint32)turn | ((uint64)(uint16)player << 32) | ((uint64)status << 48);
+   return mix(blocksHash ^ mix(gameState));
+}
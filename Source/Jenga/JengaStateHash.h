@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "JengaBlockRegistry.h"
+
+/**
+* Order-independent hash of a tower state: every block's quantized transform is hashed
+* on its own and the block hashes are summed, so the result doesn't depend on the order
+* the blocks are visited (or were registered) in. Turn, current player and tower status
+* are mixed in last. Two simulations with the same hash at the same step have (within
+* the quantization steps) the same tower.
+*/
+struct JENGA_API FJengaStateHash
+{
+   // Hash of a single block (blocks are summed up, so start from 0)
+   static uint64 HashBlock(const FTransform& transform);
+   static uint64 HashConfiguration(const TowerConfiguration& towerConf);
+
+   // Mixes the game state into the hash of the blocks
+   static uint64 Combine(uint64 blocksHash, int32 turn, int32 player, uint8 status);
+};
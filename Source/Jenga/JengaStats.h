@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+// Game logic timings and counters ("stat Jenga" in game, "csvprofile start/stop" to export them)
+DECLARE_STATS_GROUP(TEXT("Jenga"), STATGROUP_Jenga, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Game mode tick"), STAT_JengaGameModeTick, STATGROUP_Jenga, JENGA_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Next round"), STAT_JengaNextRound, STATGROUP_Jenga, JENGA_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply configuration"), STAT_JengaApplyConfiguration, STATGROUP_Jenga, JENGA_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Get configuration"), STAT_JengaGetConfiguration, STATGROUP_Jenga, JENGA_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Is on top"), STAT_JengaIsOnTop, STATGROUP_Jenga, JENGA_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Predict stability"), STAT_JengaPredictStability, STATGROUP_Jenga, JENGA_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Floor contact"), STAT_JengaFloorContact, STATGROUP_Jenga, JENGA_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Drag"), STAT_JengaDrag, STATGROUP_Jenga, JENGA_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Drag sub-step"), STAT_JengaDragSubstep, STATGROUP_Jenga, JENGA_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Blocks scanned"), STAT_JengaBlocksScanned, STATGROUP_Jenga, JENGA_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Snapshots taken"), STAT_JengaSnapshots, STATGROUP_Jenga, JENGA_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Floor contacts"), STAT_JengaFloorContacts, STATGROUP_Jenga, JENGA_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(JENGA_API, Jenga);
+
+// Times the enclosing scope, both in the stats system and in the CSV profiler.
+// It declares two scoped timers, so it can't be the single-statement body of a braceless if/for/while.
+#define JENGA_SCOPE_CYCLE_COUNTER(Stat) \
+   SCOPE_CYCLE_COUNTER(Stat); \
+   CSV_SCOPED_TIMING_STAT(Jenga, Stat)
+
+// Adds to a per-frame counter, both in the stats system and in the CSV profiler (a single statement)
+#define JENGA_INC_COUNTER(Stat, Amount) \
+   do \
+   { \
+      INC_DWORD_STAT_BY(Stat, Amount); \
+      CSV_CUSTOM_STAT(Jenga, Stat, (int32)(Amount), ECsvCustomStatOp::Accumulate); \
+   } while (0)
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaTowerGenerator.h"
+
+#include "Engine/World.h"
+#include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
+
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the blocks' transforms of a tower
+TowerConfiguration FJengaTowerGenerator::MakeConfiguration(
+   AActor* templateBlock,
+   const FVector& towerCenter,
+   int32 nLayers,
+   int32 blocksPerLayer,
+   const FVector& blockSizes)
+{
+   const FTransform templateTrx = templateBlock->GetActorTransform();
+   const FBoxSphereBounds templateBounds = templateBlock->FindComponentByClass<UStaticMeshComponent>()->Bounds;
+
+   // Blocks of the first layer are laid side by side, across their long axis
+   const FVector across = templateBounds.BoxExtent.X >= templateBounds.BoxExtent.Y ? FVector::RightVector : FVector::ForwardVector;
+   const FVector pivotOffset = templateTrx.GetLocation() - templateBounds.Origin;
+
+   TowerConfiguration towerConf;
+   towerConf.Reserve(nLayers * blocksPerLayer);
+   for (int32 layer = 0; layer < nLayers; layer++)
+   {
+      // Odd layers are rotated by 90 degrees around the tower's axis
+      const FQuat layerRotation(FVector::UpVector, (layer % 2) * HALF_PI);
+      const FVector layerAcross = layerRotation.RotateVector(across);
+      const FVector layerCenter(towerCenter.X, towerCenter.Y, templateBounds.Origin.Z + layer * blockSizes.Z);
+
+      for (int32 i = 0; i < blocksPerLayer; i++)
+      {
+         const FVector blockCenter = layerCenter + layerAcross * (i - (blocksPerLayer - 1) / 2.f) * blockSizes.Y;
+         towerConf.Add(FTransform(
+            layerRotation * templateTrx.GetRotation(),
+            blockCenter + layerRotation.RotateVector(pivotOffset),
+            templateTrx.GetScale3D()
+         ));
+      }
+   }
+
+   return towerConf;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Spawns a copy of the template block for each transform
+void FJengaTowerGenerator::Spawn(AActor* templateBlock, const TowerConfiguration& towerConf, TArray<AActor*>& outBlocks)
+{
+   FActorSpawnParameters params;
+   params.Template = templateBlock;
+   params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+   outBlocks.Reserve(outBlocks.Num() + towerConf.Num());
+   for (const auto& transform : towerConf)
+      outBlocks.Add(templateBlock->GetWorld()->SpawnActor<AActor>(templateBlock->GetClass(), transform, params));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the lowest of the given blocks
+AActor* FJengaTowerGenerator::FindTemplate(const TArray<AActor*>& blocks)
+{
+   AActor* lowest = nullptr;
+   for (const auto& block : blocks)
+      if (!lowest || block->GetActorLocation().Z < lowest->GetActorLocation().Z)
+         lowest = block;
+   return lowest;
+}
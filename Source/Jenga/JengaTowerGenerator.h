@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "JengaBlockRegistry.h"
+
+class AActor;
+
+/**
+* Builds towers of any size, copying a block of the level's bottom layer:
+* blocks are laid side by side, and every layer is rotated by 90 degrees.
+*/
+class JENGA_API FJengaTowerGenerator
+{
+public:
+   // Returns the blocks' transforms of a tower standing on the template block's layer
+   static TowerConfiguration MakeConfiguration(
+      AActor* templateBlock,
+      const FVector& towerCenter,
+      int32 nLayers,
+      int32 blocksPerLayer,
+      const FVector& blockSizes
+   );
+
+   // Spawns a copy of the template block for each transform (tagged like the template)
+   static void Spawn(AActor* templateBlock, const TowerConfiguration& towerConf, TArray<AActor*>& outBlocks);
+
+   // Returns the lowest of the given blocks (the best template)
+   static AActor* FindTemplate(const TArray<AActor*>& blocks);
+};
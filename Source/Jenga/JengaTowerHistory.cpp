@@ -0,0 +1,367 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaTowerHistory.h"
+
+
+// Blocks that moved less than this (cm), and rotated less than this (radians), don't get a new chunk
+// (0.0002 rad moves the ends of a 75 cm block by less than 0.01 cm)
+static const float BLOCK_MOVED_TOLERANCE = 0.01f;
+static const float BLOCK_ROTATED_TOLERANCE = 0.0002f;
+
+static const int32 DEFAULT_CHUNK_BLOCKS = 16;
+
+
+///////////////////////////////////////////////////////////////////////////
+// Utility that tells whether a block moved (FTransform::Equals would compare quaternion components with the cm tolerance)
+inline bool hasMoved(const FTransform& a, const FTransform& b)
+{
+   if (!a.GetLocation().Equals(b.GetLocation(), BLOCK_MOVED_TOLERANCE))
+      return true;
+
+   // The vector part of the rotation between the two is sin(angle / 2): unlike an acos, precise for tiny angles
+   const FQuat delta = a.GetRotation().Inverse() * b.GetRotation();
+   return FVector(delta.X, delta.Y, delta.Z).Size() > FMath::Sin(BLOCK_ROTATED_TOLERANCE / 2.f);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+FJengaTowerHistory::FJengaTowerHistory()
+{
+   this->root = this->current = INDEX_NONE;
+   this->firstTurn = 0;
+   this->nBlocks = 0;
+   this->usedBytes = 0;
+   this->chunkBlocks = DEFAULT_CHUNK_BLOCKS;
+   this->budgetBytes = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets the chunk size and the memory budget
+void FJengaTowerHistory::Configure(int32 chunkBlocks, int64 budgetBytes)
+{
+   // Stored turns keep their chunks: a new size needs a new history
+   const int32 newChunkBlocks = FMath::Max(1, chunkBlocks);
+   if (newChunkBlocks != this->chunkBlocks)
+      Reset(this->firstTurn);
+
+   this->chunkBlocks = newChunkBlocks;
+   this->budgetBytes = FMath::Max<int64>(0, budgetBytes);
+   EnforceBudget();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Drops all the stored turns
+void FJengaTowerHistory::Reset(int32 firstTurn)
+{
+   this->nodes.Empty();
+   this->root = this->current = INDEX_NONE;
+   this->firstTurn = firstTurn;
+   this->nBlocks = 0;
+   this->usedBytes = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Stores the configuration of the turn following the current one
+void FJengaTowerHistory::Add(const TowerConfiguration& towerConf)
+{
+   if (this->current == INDEX_NONE || towerConf.Num() != this->nBlocks)
+   {
+      Reset(this->current == INDEX_NONE ? this->firstTurn : this->nodes[this->current].turn + 1);
+      this->nBlocks = towerConf.Num();
+   }
+
+   FTurnNode node;
+   node.parent = this->current;
+   node.turn = this->current == INDEX_NONE ? this->firstTurn : this->nodes[this->current].turn + 1;
+   node.next = INDEX_NONE;
+   node.chunks.SetNum(FMath::DivideAndRoundUp(this->nBlocks, this->chunkBlocks));
+
+   for (int32 c = 0; c < node.chunks.Num(); c++)
+   {
+      const int32 start = c * this->chunkBlocks;
+      const int32 count = FMath::Min(this->chunkBlocks, this->nBlocks - start);
+
+      // Share the parent's chunk if none of its blocks moved (comparing with what we stored, so errors don't add up)
+      if (node.parent != INDEX_NONE)
+      {
+         const FChunkPtr& parentChunk = this->nodes[node.parent].chunks[c];
+         bool moved = false;
+         for (int32 i = 0; i < count && !moved; i++)
+            moved = hasMoved(towerConf[start + i], (*parentChunk)[i]);
+
+         if (!moved)
+         {
+            node.chunks[c] = parentChunk;
+            continue;
+         }
+      }
+
+      TSharedRef<FChunk, ESPMode::NotThreadSafe> chunk = MakeShared<FChunk, ESPMode::NotThreadSafe>(towerConf.GetData() + start, count);
+      this->usedBytes += sizeof(FChunk) + chunk->GetAllocatedSize();
+      node.chunks[c] = chunk;
+   }
+
+   const int32 parentIndex = node.parent;
+   const int32 nodeIndex = this->nodes.Add(MoveTemp(node));
+   if (parentIndex == INDEX_NONE)
+      this->root = nodeIndex;
+   else
+   {
+      this->nodes[parentIndex].children.Add(nodeIndex);
+      this->nodes[parentIndex].next = nodeIndex;
+   }
+   this->current = nodeIndex;
+
+   EnforceBudget();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// The next stored turn starts a new branch
+void FJengaTowerHistory::NewBranch()
+{
+   if (this->current != INDEX_NONE)
+      this->nodes[this->current].next = INDEX_NONE;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Moves to a turn of the current line and rebuilds its configuration
+bool FJengaTowerHistory::Goto(int32 turn, TowerConfiguration& towerConf)
+{
+   const int32 nodeIndex = FindOnLine(turn);
+   if (nodeIndex == INDEX_NONE)
+      return false;
+
+   // Going back: remember the way, so that the left turns can be redone
+   for (int32 child = this->current; this->nodes[child].turn > turn; child = this->nodes[child].parent)
+      this->nodes[this->nodes[child].parent].next = child;
+
+   this->current = nodeIndex;
+   Build(this->nodes[nodeIndex], towerConf);
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Follows another branch of the current turn, stepping back to the previous turn
+bool FJengaTowerHistory::SelectBranch(int32 branch)
+{
+   if (this->current == INDEX_NONE || this->nodes[this->current].parent == INDEX_NONE)
+      return false;
+
+   FTurnNode& parent = this->nodes[this->nodes[this->current].parent];
+   if (!parent.children.IsValidIndex(branch))
+      return false;
+
+   parent.next = parent.children[branch];
+   this->current = this->nodes[this->current].parent;
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Number of branches of the current turn
+int32 FJengaTowerHistory::NumBranches() const
+{
+   if (this->current == INDEX_NONE)
+      return 0;
+
+   const int32 parent = this->nodes[this->current].parent;
+   return parent == INDEX_NONE ? 1 : this->nodes[parent].children.Num();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Index of the current turn among its branches
+int32 FJengaTowerHistory::CurrentBranch() const
+{
+   if (this->current == INDEX_NONE || this->nodes[this->current].parent == INDEX_NONE)
+      return 0;
+
+   return this->nodes[this->nodes[this->current].parent].children.Find(this->current);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Last turn of the current line
+int32 FJengaTowerHistory::LastTurn() const
+{
+   if (this->current == INDEX_NONE)
+      return this->firstTurn - 1;
+
+   int32 nodeIndex = this->current;
+   while (this->nodes[nodeIndex].next != INDEX_NONE)
+      nodeIndex = this->nodes[nodeIndex].next;
+   return this->nodes[nodeIndex].turn;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Finds a turn walking back from the current one, or forward along the followed branches
+int32 FJengaTowerHistory::FindOnLine(int32 turn) const
+{
+   int32 nodeIndex = this->current;
+   while (nodeIndex != INDEX_NONE && this->nodes[nodeIndex].turn > turn)
+      nodeIndex = this->nodes[nodeIndex].parent;
+   while (nodeIndex != INDEX_NONE && this->nodes[nodeIndex].turn < turn)
+      nodeIndex = this->nodes[nodeIndex].next;
+   return nodeIndex;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Copies the chunks of a turn into a whole configuration
+void FJengaTowerHistory::Build(const FTurnNode& node, TowerConfiguration& towerConf) const
+{
+   towerConf.SetNumUninitialized(this->nBlocks, false);
+
+   FTransform* transform = towerConf.GetData();
+   for (const auto& chunk : node.chunks)
+      for (const auto& chunkTransform : *chunk)
+         *transform++ = chunkTransform;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Exports the whole tree (breadth first, the followed branch after its siblings)
+void FJengaTowerHistory::Export(TArray<TowerConfiguration>& outConfigurations, TArray<int32>& outParents, int32& outCurrent) const
+{
+   outConfigurations.Reset();
+   outParents.Reset();
+   outCurrent = INDEX_NONE;
+   if (this->root == INDEX_NONE)
+      return;
+
+   TArray<int32> order;
+   order.Add(this->root);
+   outParents.Add(INDEX_NONE);
+
+   for (int32 i = 0; i < order.Num(); i++)
+   {
+      const FTurnNode& node = this->nodes[order[i]];
+      Build(node, outConfigurations[outConfigurations.AddDefaulted()]);
+      if (order[i] == this->current)
+         outCurrent = i;
+
+      for (const int32 child : node.children)
+         if (child != node.next)
+         {
+            order.Add(child);
+            outParents.Add(i);
+         }
+      if (node.next != INDEX_NONE)
+      {
+         order.Add(node.next);
+         outParents.Add(i);
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Imports a whole tree (the last child of every turn is its followed branch)
+bool FJengaTowerHistory::Import(int32 firstTurn, const TArray<TowerConfiguration>& configurations, const TArray<int32>& parents, int32 current)
+{
+   Reset(firstTurn);
+   if (configurations.Num() == 0 || parents.Num() != configurations.Num() || !configurations.IsValidIndex(current))
+      return false;
+
+   // Don't drop turns while they are still coming
+   TGuardValue<int64> noBudget(this->budgetBytes, 0);
+
+   TArray<int32> imported;
+   imported.SetNumUninitialized(configurations.Num());
+   for (int32 i = 0; i < configurations.Num(); i++)
+   {
+      const bool validParent = i == 0 ? parents[i] == INDEX_NONE : parents[i] >= 0 && parents[i] < i;
+      if (!validParent || configurations[i].Num() != configurations[0].Num())
+      {
+         Reset(firstTurn);
+         return false;
+      }
+
+      this->current = i == 0 ? INDEX_NONE : imported[parents[i]];
+      Add(configurations[i]);
+      imported[i] = this->current;
+   }
+
+   // The current line leads to the current turn
+   this->current = imported[current];
+   for (int32 child = this->current; this->nodes[child].parent != INDEX_NONE; child = this->nodes[child].parent)
+      this->nodes[this->nodes[child].parent].next = child;
+
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the memory used by the stored turns
+int64 FJengaTowerHistory::GetMemoryUsage() const
+{
+   int64 bytes = this->usedBytes + this->nodes.GetAllocatedSize();
+   for (const auto& node : this->nodes)
+      bytes += node.chunks.GetAllocatedSize() + node.children.GetAllocatedSize();
+   return bytes;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the memory that a full snapshot for each turn would use
+int64 FJengaTowerHistory::GetFullSnapshotsMemoryUsage() const
+{
+   return (int64)this->nodes.Num() * (sizeof(TowerConfiguration) + this->nBlocks * sizeof(FTransform));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Removes a turn, freeing the chunks nobody else shares (links are up to the caller)
+void FJengaTowerHistory::RemoveNode(int32 nodeIndex)
+{
+   for (const auto& chunk : this->nodes[nodeIndex].chunks)
+      if (chunk.GetSharedReferenceCount() == 1)
+         this->usedBytes -= sizeof(FChunk) + chunk->GetAllocatedSize();
+
+   this->nodes.RemoveAt(nodeIndex);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Removes a turn and all the turns branching from it (children first)
+void FJengaTowerHistory::RemoveSubtree(int32 nodeIndex)
+{
+   TArray<int32> subtree;
+   subtree.Add(nodeIndex);
+   for (int32 i = 0; i < subtree.Num(); i++)
+      subtree.Append(this->nodes[subtree[i]].children);
+
+   for (int32 i = subtree.Num() - 1; i >= 0; i--)
+      RemoveNode(subtree[i]);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Drops the oldest turns until the memory budget is respected
+void FJengaTowerHistory::EnforceBudget()
+{
+   if (this->budgetBytes <= 0)
+      return;
+
+   // Always keep the current turn
+   while (this->nodes.Num() > 1 && GetMemoryUsage() > this->budgetBytes)
+   {
+      // The child of the first turn leading to the current turn
+      int32 currentChild = INDEX_NONE;
+      for (int32 nodeIndex = this->current; nodeIndex != this->root; nodeIndex = this->nodes[nodeIndex].parent)
+         currentChild = nodeIndex;
+
+      FTurnNode& rootNode = this->nodes[this->root];
+      if (rootNode.children.Num() == 1 && currentChild != INDEX_NONE)
+      {
+         // Drop the first turn: the chunks it shared stay with the next one
+         const int32 newRoot = rootNode.children[0];
+         RemoveNode(this->root);
+         this->root = newRoot;
+         this->nodes[newRoot].parent = INDEX_NONE;
+         this->firstTurn = this->nodes[newRoot].turn;
+      }
+      else
+      {
+         // Drop a branch off the current line (the followed one last)
+         int32 dropped = INDEX_NONE;
+         for (const int32 child : rootNode.children)
+            if (child != currentChild && (dropped == INDEX_NONE || dropped == rootNode.next))
+               dropped = child;
+
+         rootNode.children.Remove(dropped);
+         if (rootNode.next == dropped)
+            rootNode.next = INDEX_NONE;
+         RemoveSubtree(dropped);
+      }
+   }
+}
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/SparseArray.h"
+#include "Templates/SharedPointer.h"
+#include "JengaBlockRegistry.h"
+
+/**
+* Stores the tower configuration of every turn for undo/redo, as a tree: a new move
+* after an undo starts a new branch instead of discarding the undone turns.
+* Every turn keeps its blocks in fixed size chunks shared copy-on-write with its parent turn,
+* so a turn only costs the chunks holding the blocks that moved.
+* The oldest turns (and the branches off the current line) are dropped when the memory budget is exceeded.
+*/
+class JENGA_API FJengaTowerHistory
+{
+public:
+   FJengaTowerHistory();
+
+   // Sets the blocks per shared chunk and the memory budget (in bytes, 0 means unlimited)
+   void Configure(int32 chunkBlocks, int64 budgetBytes);
+
+   // Drops all the stored turns (the next stored turn will be the given one)
+   void Reset(int32 firstTurn = 0);
+
+   // Stores the configuration of the turn following the current one, which becomes the current turn
+   void Add(const TowerConfiguration& towerConf);
+
+   // The next stored turn starts a new branch after the current one (its other branches are kept)
+   void NewBranch();
+
+   // Moves to a turn of the current line (an ancestor, or a turn of the branches last followed) and rebuilds it
+   bool Goto(int32 turn, TowerConfiguration& towerConf);
+
+   // Makes another branch the followed one at the current turn: the next Goto of the current turn reaches it
+   bool SelectBranch(int32 branch);
+
+   // Branches of the current turn (alternative versions of it, sharing its previous turn)
+   int32 NumBranches() const;
+   int32 CurrentBranch() const;
+
+   // Range of the turns of the current line still available
+   int32 FirstTurn() const { return firstTurn; }
+   int32 LastTurn() const;
+   bool Contains(int32 turn) const { return FindOnLine(turn) != INDEX_NONE; }
+
+   // Exports/imports the whole tree: every parent comes before its children (INDEX_NONE for the first turn)
+   void Export(TArray<TowerConfiguration>& outConfigurations, TArray<int32>& outParents, int32& outCurrent) const;
+   bool Import(int32 firstTurn, const TArray<TowerConfiguration>& configurations, const TArray<int32>& parents, int32 current);
+
+   // Memory actually used, and memory that full snapshots of the same turns would use
+   int64 GetMemoryUsage() const;
+   int64 GetFullSnapshotsMemoryUsage() const;
+
+private:
+   typedef TArray<FTransform> FChunk;
+   typedef TSharedPtr<const FChunk, ESPMode::NotThreadSafe> FChunkPtr;
+
+   struct FTurnNode
+   {
+      int32 parent;
+      int32 turn;
+      // The branch followed by redo (INDEX_NONE: none)
+      int32 next;
+      TArray<int32> children;
+      TArray<FChunkPtr> chunks;
+   };
+
+   int32 FindOnLine(int32 turn) const;
+   void Build(const FTurnNode& node, TowerConfiguration& towerConf) const;
+   void RemoveNode(int32 nodeIndex);
+   void RemoveSubtree(int32 nodeIndex);
+   void EnforceBudget();
+
+   TSparseArray<FTurnNode> nodes;
+   int32 root, current;
+   int32 firstTurn;
+   int32 nBlocks;
+
+   // Memory of the nodes and of the chunks they own
+   int64 usedBytes;
+
+   int32 chunkBlocks;
+   int64 budgetBytes;
+};
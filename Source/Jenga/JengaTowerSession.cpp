@@ -0,0 +1,886 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaTowerSession.h"
+#include "Jenga.h"
+#include "JengaStats.h"
+#include "JengaReplay.h"
+#include "JengaSaveFile.h"
+#include "JengaPerfCounters.h"
+#include "JengaEventLog.h"
+#include "JengaHashTrace.h"
+#include "JengaStateHash.h"
+
+#include "EngineGlobals.h"
+#include "HAL/PlatformTime.h"
+#include "Runtime/Engine/Classes/Engine/Engine.h"
+#include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
+#include "Runtime/Engine/Classes/Materials/MaterialInstanceDynamic.h"
+#include "Runtime/CoreUObject/Public/UObject/ConstructorHelpers.h"
+
+
+static const FVector BLOCK_SIZES = FVector(75.f, 25.f, 15.f);
+static const float BLOCKS_MAX_RANDOM_OFFSET = 0.8f;
+static const float BLOCKS_BALANCE_SPEED_THRESHOLD = 7.f;
+static const float BLOCKS_BALANCE_SETTLE_TIME = 0.2f;
+static const float BLOCKS_ON_FLOOR_TOLERANCE = 0.05f;
+
+// Once released blocks are slower than this, the tower's future is predicted from the blocks' poses
+// (the released one must have been at rest for BLOCKS_BALANCE_SETTLE_TIME: it may be still in the air)
+static const float PREDICTION_SPEED_LIMIT = 20.f;
+static const float PREDICTION_MARGIN = 1.f;
+
+// Settled bottom layers are frozen, except the top ones and the ones close to a pick or a moving block
+static const int32 FREEZE_ACTIVE_LAYERS = 3;
+static const int32 FREEZE_MARGIN = 2;
+static const int32 FREEZE_REST_ROUNDS = 2;
+
+// A tower nobody picked for this long is put to sleep, even if some blocks still jitter
+static const float IDLE_SLEEP_TIME = 10.f;
+
+// Risky blocks are tinted by removal risk, from level 1 (low risk) to HEATMAP_LEVELS (the tower would fall),
+// with tints of the engine's basic shape material (its "Color" parameter)
+static const int32 HEATMAP_LEVELS = 4;
+static const FLinearColor HEATMAP_COLORS[HEATMAP_LEVELS] = {
+   FLinearColor(1.f, 0.9f, 0.1f), FLinearColor(1.f, 0.5f, 0.f), FLinearColor(1.f, 0.1f, 0.f), FLinearColor(0.6f, 0.f, 0.6f)
+};
+static const TCHAR* const HEATMAP_MATERIAL = TEXT("/Engine/BasicShapes/BasicShapeMaterial");
+static const FName HEATMAP_COLOR_PARAMETER = "Color";
+
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+UJengaTowerSession::UJengaTowerSession()
+{
+   turn = -1;
+   moves = 0;
+   nPlayers = 1;
+   pickedJengaBlock = nullptr;
+   holdingPickedJengaBlock = false;
+   towerStatus = TowerStatus::BALANCED;
+   towerCenter = FVector::ZeroVector;
+   seed = 0;
+   idleTime = 0.f;
+   releasedRestTime = 0.f;
+   showMessages = true;
+   recorder = nullptr;
+   perfCounters = nullptr;
+   releaseSeconds = 0.0;
+   eventLog = nullptr;
+   towerIndex = 0;
+   hashTrace = nullptr;
+   turnHash = 0;
+   applyingConfiguration = false;
+   freezeLayers = false;
+   loadHeatmap = false;
+
+   static ConstructorHelpers::FObjectFinder<UMaterialInterface> heatmapMaterialFinder(HEATMAP_MATERIAL);
+   heatmapBaseMaterial = heatmapMaterialFinder.Succeeded() ? heatmapMaterialFinder.Object : nullptr;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Takes ownership of a tower's blocks
+void UJengaTowerSession::Init(const TArray<AActor*>& blocks, int32 historyChunkBlocks, int64 historyBudgetBytes, bool showMessages)
+{
+   this->showMessages = showMessages;
+   this->jengaBlocks.Register(blocks);
+
+   // Track blocks' wake/sleep events to know when the tower is at rest
+   this->stability.Configure(BLOCKS_BALANCE_SPEED_THRESHOLD, BLOCKS_BALANCE_SETTLE_TIME);
+   this->stability.Init(this->jengaBlocks);
+   this->stabilityAnalyzer.Configure(BLOCK_SIZES, PREDICTION_MARGIN);
+   this->loadAnalyzer.Configure(&this->stabilityAnalyzer, BLOCK_SIZES);
+   for (int32 i = 0; i < this->jengaBlocks.Num(); i++)
+   {
+      this->jengaBlocks.GetMesh(i)->OnComponentWake.AddDynamic(this, &UJengaTowerSession::OnBlockWake);
+      this->jengaBlocks.GetMesh(i)->OnComponentSleep.AddDynamic(this, &UJengaTowerSession::OnBlockSleep);
+      this->jengaBlocks.GetMesh(i)->SetGenerateOverlapEvents(true);
+   }
+
+   // Blocks get their own material back when the heatmap no longer tints them
+   this->blockMaterials.SetNum(this->jengaBlocks.Num());
+   this->heatLevels.Init(0, this->jengaBlocks.Num());
+   for (int32 i = 0; i < this->jengaBlocks.Num(); i++)
+      this->blockMaterials[i] = this->jengaBlocks.GetMesh(i)->GetMaterial(0);
+
+   // Bucket blocks by layer
+   this->layers.Init(this->jengaBlocks.Num(), BLOCK_SIZES.Z);
+   this->blockStates.Init(this->jengaBlocks.Num());
+   this->freezer.Configure(FREEZE_ACTIVE_LAYERS, FREEZE_MARGIN, FREEZE_REST_ROUNDS);
+   this->freezer.Init(this->jengaBlocks.Num());
+
+   // Find the tower's vertical axis
+   this->towerCenter = FVector::ZeroVector;
+   for (int32 i = 0; i < this->jengaBlocks.Num(); i++)
+      this->towerCenter += this->jengaBlocks.GetMesh(i)->Bounds.Origin / this->jengaBlocks.Num();
+   this->towerCenter.Z = 0.f;
+
+   // Setup the undo/redo history
+   this->history.Configure(historyChunkBlocks, historyBudgetBytes);
+
+   // Save the initial blocks configuration
+   this->defaultConfiguration = GetActualTowerConfiguration();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Resets the blocks positions and starts a new game with a given random seed
+void UJengaTowerSession::NewGame(int nPlayers, int32 seed)
+{
+   // Init game parameters
+   this->seed = seed;
+   this->random.Initialize(seed);
+   this->turn = -1;
+   this->moves = 0;
+   this->nPlayers = nPlayers;
+   this->holdingPickedJengaBlock = false;
+   this->towerStatus = TowerStatus::BALANCED;
+   this->releaseSeconds = 0.0;
+
+   // Clear the old configurations
+   this->history.Reset();
+
+   // Save those blocks touching the floor (they should be 3)
+   FindBlocksOnFloor();
+
+   // Load the first (pinpoint accurate) tower configuration, with a little randomness
+   // on blocks' positions (this stops the tower's jelly effect!)
+   TowerConfiguration towerConf = this->defaultConfiguration;
+   for (auto& trx : towerConf)
+   {
+      trx.SetLocation(trx.GetLocation() + FVector(
+         this->random.FRandRange(-BLOCKS_MAX_RANDOM_OFFSET, BLOCKS_MAX_RANDOM_OFFSET),
+         this->random.FRandRange(-BLOCKS_MAX_RANDOM_OFFSET, BLOCKS_MAX_RANDOM_OFFSET),
+         this->random.FRandRange(-BLOCKS_MAX_RANDOM_OFFSET, BLOCKS_MAX_RANDOM_OFFSET)
+      ));
+   }
+   ApplyTowerConfiguration(towerConf, false);
+   this->gameConfiguration = GetActualTowerConfiguration();
+
+   // Game start message
+   if (this->showMessages)
+      ShowMessage(FColor::Green, "Starting a game with " + FString::FromInt(this->nPlayers) + " player(s)!");
+   if (this->recorder)
+      this->recorder->RecordNewGame(seed, nPlayers);
+   if (this->eventLog)
+      this->eventLog->Log(FJengaGameEvent::GAME_START, this->towerIndex, this->turn, 0, INDEX_NONE, nPlayers);
+
+   // First player can move!
+   NextRound();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called to lock current's player block to this one
+void UJengaTowerSession::NewPick(AActor* block, const FVector& grabPoint)
+{
+   if (this->recorder)
+      this->recorder->RecordPick(this->jengaBlocks.IndexOf(block), grabPoint);
+
+   if (this->showMessages)
+      ShowMessage(FColor::Green, "Player " + FString::FromInt(CurrentPlayer() + 1) + " picks " + block->GetName());
+
+   // Save the picked block
+   const int32 index = this->jengaBlocks.IndexOf(block);
+   LogEvent(FJengaGameEvent::PICK, index);
+   if (this->freezeLayers)
+      this->freezer.UnfreezeFrom(this->jengaBlocks, this->layers, this->layers.GetLayer(index));
+   this->pickedJengaBlock = block;
+   this->holdingPickedJengaBlock = true;
+   this->blockStates.Set(index, FJengaBlockStates::PICKED, true);
+   this->blockStates.Set(index, FJengaBlockStates::ON_FLOOR, false);
+
+   // Block interactivity on all blocks
+   this->blockStates.SetAll(FJengaBlockStates::INTERACTIVE, false);
+
+   // Enable highlight and interactivity only on the picked one!
+   this->blockStates.Set(index, FJengaBlockStates::INTERACTIVE, true);
+   this->jengaBlocks.GetMesh(this->pickedJengaBlock)->SetRenderCustomDepth(true);
+   this->stability.ResetRestTime();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called every frame by the game mode
+void UJengaTowerSession::Tick(float deltaTime)
+{
+   if (this->recorder)
+      this->recorder->Advance(deltaTime);
+
+   // Show the last tower analysis, as soon as the workers are done with it
+   if (this->loadAnalyzer.Update() && this->loadHeatmap)
+      ApplyLoadHeatmap();
+
+   // An idle tower costs nothing to the physics scene
+   this->idleTime = this->pickedJengaBlock ? 0.f : this->idleTime + deltaTime;
+   if (IsIdle() && this->stability.GetAwakeCount() > 0)
+      PutBlocksToSleep();
+
+   if (this->pickedJengaBlock && this->towerStatus != TowerStatus::COLLAPSED)
+   {
+      if (this->freezeLayers && this->freezer.GetFrozenLayers() > 0)
+         UnfreezeAroundAwakeBlocks();
+
+      // Estabilish the balance status of the tower (only awake blocks are checked)
+      JENGA_INC_COUNTER(STAT_JengaBlocksScanned, this->stability.GetAwakeCount());
+      this->stability.Update(deltaTime);
+      this->towerStatus = this->stability.IsSettled() ? TowerStatus::BALANCED : TowerStatus::MOVING;
+
+      if (!this->holdingPickedJengaBlock)
+      {
+         // The released block is at rest once it stays slow (it speeds up in its first frame if it's falling)
+         const UStaticMeshComponent* releasedMesh = this->jengaBlocks.GetMesh(this->pickedJengaBlock);
+         const bool releasedSlow = !releasedMesh->RigidBodyIsAwake()
+            || releasedMesh->GetPhysicsLinearVelocity().SizeSquared() <= BLOCKS_BALANCE_SPEED_THRESHOLD * BLOCKS_BALANCE_SPEED_THRESHOLD;
+         this->releasedRestTime = releasedSlow ? this->releasedRestTime + deltaTime : 0.f;
+
+         // No need to wait for the tower to stop when its future is obvious
+         FJengaStabilityAnalyzer::Prediction prediction = FJengaStabilityAnalyzer::UNCERTAIN;
+         if (this->towerStatus == TowerStatus::MOVING && this->releasedRestTime >= BLOCKS_BALANCE_SETTLE_TIME
+            && this->stability.AreAwakeBlocksSlowerThan(PREDICTION_SPEED_LIMIT))
+            prediction = PredictStability();
+
+         if (prediction == FJengaStabilityAnalyzer::COLLAPSING)
+         {
+            this->towerStatus = TowerStatus::COLLAPSED;
+            GameOver(TEXT("Tower is collapsing!"));
+         }
+
+         // Ok, the tower is balanced and the player has released the block...
+         else if (this->towerStatus == TowerStatus::BALANCED || prediction == FJengaStabilityAnalyzer::STABLE)
+            TryNextRound();
+      }
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Turns the settled bottom layers into kinematic bodies
+void UJengaTowerSession::SetLayerFreezing(bool enabled)
+{
+   this->freezeLayers = enabled;
+   if (!enabled)
+      this->freezer.UnfreezeFrom(this->jengaBlocks, this->layers, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Analyzes the tower in the background at every turn, and tints the risky blocks
+void UJengaTowerSession::SetLoadHeatmap(bool enabled)
+{
+   // One tint per risk level, shared by all the blocks
+   if (enabled && this->heatmapMaterials.Num() == 0 && this->heatmapBaseMaterial)
+   {
+      for (int32 level = 0; level < HEATMAP_LEVELS; level++)
+      {
+         UMaterialInstanceDynamic* material = UMaterialInstanceDynamic::Create(this->heatmapBaseMaterial, this);
+         material->SetVectorParameterValue(HEATMAP_COLOR_PARAMETER, HEATMAP_COLORS[level]);
+         this->heatmapMaterials.Add(material);
+      }
+   }
+   if (enabled && this->heatmapMaterials.Num() == 0)
+      UE_LOG(LogJenga, Warning, TEXT("Load heatmap: cannot load %s, blocks won't be tinted"), HEATMAP_MATERIAL);
+
+   this->loadHeatmap = enabled;
+   if (enabled)
+      RequestLoadAnalysis();
+   else
+   {
+      for (int32 i = 0; i < this->jengaBlocks.Num(); i++)
+         SetHeatLevel(i, 0);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Tints a block by risk level (0 gives it its own material back)
+void UJengaTowerSession::SetHeatLevel(int32 index, int32 level)
+{
+   if (this->heatLevels[index] == level || (level > 0 && this->heatmapMaterials.Num() == 0))
+      return;
+
+   this->heatLevels[index] = level;
+   this->jengaBlocks.GetMesh(index)->SetMaterial(0, level > 0 ? this->heatmapMaterials[level - 1] : this->blockMaterials[index]);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Hands the blocks' poses to the load analyzer's workers
+void UJengaTowerSession::RequestLoadAnalysis()
+{
+   GetBlockPoses(this->blockPoses);
+   this->loadAnalyzer.Request(this->blockPoses);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Tints the blocks by removal risk (the picked block keeps its outline on top)
+void UJengaTowerSession::ApplyLoadHeatmap()
+{
+   const TArray<FJengaBlockLoad>& loads = this->loadAnalyzer.GetLoads();
+   if (loads.Num() != this->jengaBlocks.Num())
+      return;
+
+   int32 riskiest = INDEX_NONE, heaviest = INDEX_NONE;
+   for (int32 i = 0; i < loads.Num(); i++)
+   {
+      if (riskiest == INDEX_NONE || loads[i].risk > loads[riskiest].risk)
+         riskiest = i;
+      if (heaviest == INDEX_NONE || loads[i].load > loads[heaviest].load)
+         heaviest = i;
+
+      SetHeatLevel(i, FMath::Clamp(FMath::RoundToInt(loads[i].risk * HEATMAP_LEVELS), 0, HEATMAP_LEVELS));
+   }
+
+   UE_LOG(LogJenga, Verbose, TEXT("Load analysis: %d blocks in %.2f ms, heaviest load %.1f blocks (%d), riskiest removal %.2f (%d)%s"),
+      loads.Num(), this->loadAnalyzer.GetLastAnalysisMs(), loads[heaviest].load, heaviest, loads[riskiest].risk, riskiest,
+      this->loadAnalyzer.AreRisksKnown() ? TEXT("") : TEXT(", risks unknown"));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Simulates again the frozen layers a moving block is getting close to
+void UJengaTowerSession::UnfreezeAroundAwakeBlocks()
+{
+   int32 lowestLayer = MAX_int32;
+   for (const int32 index : this->stability.GetAwakeBlocks())
+      lowestLayer = FMath::Min(lowestLayer, this->layers.LayerOf(this->jengaBlocks.GetBlock(index)->GetActorLocation().Z));
+
+   if (lowestLayer - this->freezer.GetMargin() < this->freezer.GetFrozenLayers())
+      this->freezer.UnfreezeFrom(this->jengaBlocks, this->layers, lowestLayer);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Has nobody played this tower for a while?
+bool UJengaTowerSession::IsIdle() const
+{
+   return this->idleTime >= IDLE_SLEEP_TIME;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Puts the awake blocks to sleep
+void UJengaTowerSession::PutBlocksToSleep()
+{
+   const TArray<int32> awakeBlocks = this->stability.GetAwakeBlocks();
+   for (const int32 index : awakeBlocks)
+   {
+      this->jengaBlocks.GetMesh(index)->PutRigidBodyToSleep();
+      this->stability.OnSleep(index);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Ends the turn if the released block is on top of the tower
+void UJengaTowerSession::TryNextRound()
+{
+   RefreshLayers();
+
+   // Estabilish if the move is good or not!
+   if (IsOnTop(this->pickedJengaBlock))
+   {
+      // A new move after an undo starts a new branch (the undone turns are kept)
+      this->towerStatus = TowerStatus::BALANCED;
+      this->history.NewBranch();
+      this->moves = this->turn;
+      NextRound();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Predicts the tower's future from its blocks' poses
+FJengaStabilityAnalyzer::Prediction UJengaTowerSession::PredictStability()
+{
+   JENGA_SCOPE_CYCLE_COUNTER(STAT_JengaPredictStability);
+   JENGA_INC_COUNTER(STAT_JengaBlocksScanned, this->jengaBlocks.Num());
+
+   GetBlockPoses(this->blockPoses);
+   return this->stabilityAnalyzer.Analyze(this->blockPoses);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the rotation and the centre of every block
+void UJengaTowerSession::GetBlockPoses(TArray<FTransform>& outPoses) const
+{
+   outPoses.SetNum(this->jengaBlocks.Num(), false);
+   for (int32 i = 0; i < this->jengaBlocks.Num(); i++)
+   {
+      const UStaticMeshComponent* mesh = this->jengaBlocks.GetMesh(i);
+      outPoses[i] = FTransform(mesh->GetComponentQuat(), mesh->Bounds.Origin);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called when the player has released the picked block
+void UJengaTowerSession::PickReleased(AActor* block)
+{
+   this->holdingPickedJengaBlock = false;
+   this->releasedRestTime = 0.f;
+   this->releaseSeconds = FPlatformTime::Seconds();
+   if (this->recorder)
+      this->recorder->RecordRelease();
+   LogEvent(FJengaGameEvent::RELEASE, this->jengaBlocks.IndexOf(block));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called when the player drags the picked block
+void UJengaTowerSession::DragUpdated(AActor* block, const FVector& target)
+{
+   if (this->recorder)
+      this->recorder->RecordTarget(target);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Goes back to the previous round
+void UJengaTowerSession::Undo()
+{
+   if (this->towerStatus != TowerStatus::BALANCED)
+      ShowMessage(FColor::Yellow, "Cannot undo: Tower is not balanced!");
+
+   else if (this->holdingPickedJengaBlock)
+      ShowMessage(FColor::Yellow, "Cannot undo: You are holding a block!");
+
+   else if (this->turn < 1)
+      ShowMessage(FColor::Yellow, "Cannot undo: This is the first turn!");
+
+   else if (!this->history.Contains(this->turn - 1))
+      ShowMessage(FColor::Yellow, "Cannot undo: This turn is too old!");
+
+   else
+   {
+      if (this->recorder)
+         this->recorder->RecordUndo();
+      LogEvent(FJengaGameEvent::UNDO);
+      this->turn-=2;
+      NextRound();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Restores a canceled round
+void UJengaTowerSession::Redo()
+{
+   if (this->towerStatus != TowerStatus::BALANCED)
+      ShowMessage(FColor::Yellow, "Cannot redo: Tower is not balanced!");
+
+   else if (this->holdingPickedJengaBlock)
+      ShowMessage(FColor::Yellow, "Cannot redo: You are holding a block!");
+
+   else if (!this->history.Contains(this->turn + 1))
+      ShowMessage(FColor::Yellow, "Cannot redo: No turns ahead!");
+
+   else
+   {
+      if (this->recorder)
+         this->recorder->RecordRedo();
+      LogEvent(FJengaGameEvent::REDO);
+      NextRound();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Replays the current turn as it was played on another branch
+void UJengaTowerSession::SwitchBranch(int32 branch)
+{
+   if (this->towerStatus != TowerStatus::BALANCED)
+      ShowMessage(FColor::Yellow, "Cannot switch branch: Tower is not balanced!");
+
+   else if (this->holdingPickedJengaBlock)
+      ShowMessage(FColor::Yellow, "Cannot switch branch: You are holding a block!");
+
+   else if (branch == this->history.CurrentBranch())
+      ShowMessage(FColor::Yellow, "Cannot switch branch: Already on it!");
+
+   else if (!this->history.SelectBranch(branch))
+      ShowMessage(FColor::Yellow, "Cannot switch branch: No such branch!");
+
+   else
+   {
+      // The history stepped back to the previous turn: the next round follows the selected branch
+      if (this->recorder)
+         this->recorder->RecordBranch(branch);
+      LogEvent(FJengaGameEvent::BRANCH);
+      this->turn--;
+      this->moves = this->history.LastTurn();
+      NextRound();
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Exports the whole game
+void UJengaTowerSession::SaveGame(FJengaSavedGame& outGame)
+{
+   outGame.nPlayers = this->nPlayers;
+   outGame.turn = this->turn;
+   outGame.moves = this->moves;
+   outGame.seed = this->seed;
+   outGame.firstTurn = this->history.FirstTurn();
+   outGame.defaultConfiguration = this->defaultConfiguration;
+   this->history.Export(outGame.turns, outGame.parents, outGame.current);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Restores a saved game
+bool UJengaTowerSession::LoadGame(const FJengaSavedGame& game)
+{
+   const int32 nBlocks = this->jengaBlocks.Num();
+   if (game.defaultConfiguration.Num() != nBlocks || game.turns.Num() == 0 || game.parents.Num() != game.turns.Num() || !game.turns.IsValidIndex(game.current) || game.nPlayers < 1)
+      return false;
+   TArray<int32> depths;
+   depths.SetNumUninitialized(game.turns.Num());
+   int32 maxDepth = 0;
+   for (int32 i = 0; i < game.turns.Num(); i++)
+   {
+      if (game.turns[i].Num() != nBlocks || game.parents[i] >= i || game.parents[i] < INDEX_NONE || (game.parents[i] == INDEX_NONE) != (i == 0))
+         return false;
+      depths[i] = i == 0 ? 0 : depths[game.parents[i]] + 1;
+      maxDepth = FMath::Max(maxDepth, depths[i]);
+   }
+
+   // Turns played can't go past the last turn of the history
+   if (game.moves < game.firstTurn || game.moves > game.firstTurn + maxDepth)
+      return false;
+
+   // The saved turn must be the one of the current branch
+   int32 currentTurn = game.firstTurn;
+   for (int32 i = game.current; game.parents[i] != INDEX_NONE; i = game.parents[i])
+      currentTurn++;
+   if (currentTurn != game.turn)
+      return false;
+
+   if (this->pickedJengaBlock)
+      this->jengaBlocks.GetMesh(this->pickedJengaBlock)->SetRenderCustomDepth(false);
+   this->pickedJengaBlock = nullptr;
+   this->holdingPickedJengaBlock = false;
+   this->towerStatus = TowerStatus::BALANCED;
+
+   this->nPlayers = game.nPlayers;
+   this->seed = game.seed;
+   this->random.Initialize(game.seed);
+   this->defaultConfiguration = game.defaultConfiguration;
+   this->gameConfiguration = game.turns[0];
+   FindBlocksOnFloor();
+
+   this->history.Import(game.firstTurn, game.turns, game.parents, game.current);
+
+   // Let the next round restore the saved turn
+   this->turn = game.turn - 1;
+   this->moves = game.moves;
+   NextRound();
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Jumps to a given turn, with the given tower configuration (its history is lost)
+void UJengaTowerSession::RestoreTurn(int turn, const TowerConfiguration& towerConf)
+{
+   if (this->pickedJengaBlock)
+      this->jengaBlocks.GetMesh(this->pickedJengaBlock)->SetRenderCustomDepth(false);
+   this->pickedJengaBlock = nullptr;
+   this->holdingPickedJengaBlock = false;
+   this->towerStatus = TowerStatus::BALANCED;
+
+   this->history.Reset(turn);
+   this->turn = turn - 1;
+   this->moves = turn - 1;
+   ApplyTowerConfiguration(towerConf, true);
+   NextRound();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Increases the turn counter number and initializes the next round
+void UJengaTowerSession::NextRound()
+{
+   JENGA_SCOPE_CYCLE_COUNTER(STAT_JengaNextRound);
+
+   this->turn++;
+   this->moves = FMath::Max(this->turn, this->moves);
+
+   // Time the player waited for the turn to end
+   if (this->perfCounters && this->releaseSeconds > 0.0)
+      this->perfCounters->Add(FJengaPerfCounters::TURN_LATENCY, 1000.0 * (FPlatformTime::Seconds() - this->releaseSeconds));
+   this->releaseSeconds = 0.0;
+
+   // Show debug message
+   if (this->showMessages)
+   {
+      FString debugStr = "Turn " + FString::FromInt(this->turn + 1);
+      if (this->nPlayers > 1)
+         debugStr += ": Player " + FString::FromInt(CurrentPlayer() + 1) + " moves!";
+      ShowMessage(FColor::Green, debugStr);
+   }
+
+   // Do we already had this turn? (because of undos/redos/branch switches)
+   TowerConfiguration towerConf;
+   if (this->turn == -1)
+      ApplyTowerConfiguration(this->gameConfiguration, false);
+   else if (this->history.Goto(this->turn, towerConf))
+      ApplyTowerConfiguration(towerConf, true);
+   else
+      this->history.Add(GetActualTowerConfiguration());
+
+   // This turn has been played in more ways
+   if (this->showMessages && this->history.NumBranches() > 1)
+      ShowMessage(FColor::Cyan, FString::Printf(TEXT("Branch %d of %d"), this->history.CurrentBranch() + 1, this->history.NumBranches()));
+
+   if (this->recorder)
+      this->recorder->RecordTurn(this->turn, GetActualTowerConfiguration());
+
+   // Fingerprint the turn, to find where two runs diverge
+   this->turnHash = ComputeStateHash();
+   LogEvent(FJengaGameEvent::TURN, INDEX_NONE, this->turnHash);
+   if (this->hashTrace)
+      this->hashTrace->Record(FJengaHashTrace::TURN, this->towerIndex, this->turn, this->turnHash);
+
+   UE_LOG(LogJenga, Verbose, TEXT("History: %lld bytes (full snapshots would take %lld bytes)"),
+      this->history.GetMemoryUsage(), this->history.GetFullSnapshotsMemoryUsage());
+
+   // Make sure all blocks are interactive (except the top ones!)
+   RefreshInteractivity();
+
+   // The tower is at rest: its settled bottom layers don't need to be simulated
+   if (this->freezeLayers)
+      this->freezer.FreezeSettled(this->jengaBlocks, this->layers, this->stability);
+
+   // Deactivate the previously picked block (if any)
+   this->blockStates.SetAll(FJengaBlockStates::PICKED, false);
+   if (this->pickedJengaBlock)
+   {
+      this->jengaBlocks.GetMesh(this->pickedJengaBlock)->SetRenderCustomDepth(false);
+      this->pickedJengaBlock = nullptr;
+   }
+
+   // The tower is at rest: analyze it while the next player thinks
+   if (this->loadHeatmap)
+      RequestLoadAnalysis();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Game over event
+void UJengaTowerSession::GameOver(const TCHAR* msg)
+{
+   if (this->showMessages)
+   {
+      ShowMessage(FColor::Red, msg);
+      ShowMessage(FColor::Red, "Game over for Player " + FString::FromInt(CurrentPlayer() + 1) + "!");
+   }
+   LogEvent(FJengaGameEvent::COLLAPSE, this->jengaBlocks.IndexOf(this->pickedJengaBlock));
+
+   // Deactivate the picked block (the tower may collapse after the turn ended, with no pick)
+   if (this->pickedJengaBlock)
+   {
+      this->blockStates.Set(this->jengaBlocks.IndexOf(this->pickedJengaBlock), FJengaBlockStates::INTERACTIVE, false);
+      this->jengaBlocks.GetMesh(this->pickedJengaBlock)->SetRenderCustomDepth(false);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Logs an event of this tower (if an event log is attached)
+void UJengaTowerSession::LogEvent(FJengaGameEvent::Type type, int32 block, uint64 hash)
+{
+   if (this->eventLog)
+      this->eventLog->Log(type, this->towerIndex, this->turn, CurrentPlayer(), block, 0, hash);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Hashes the tower's state
+uint64 UJengaTowerSession::ComputeStateHash()
+{
+   uint64 blocksHash = 0;
+   for (int32 i = 0; i < this->jengaBlocks.Num(); i++)
+      blocksHash += FJengaStateHash::HashBlock(this->jengaBlocks.GetBlock(i)->GetTransform());
+
+   return FJengaStateHash::Combine(blocksHash, this->turn, CurrentPlayer(), (uint8)this->towerStatus);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the index of the current player (0-based)
+int UJengaTowerSession::CurrentPlayer()
+{
+   return (this->turn % this->nPlayers);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Is this block on top of the tower?
+bool UJengaTowerSession::IsOnTop(AActor* block)
+{
+   JENGA_SCOPE_CYCLE_COUNTER(STAT_JengaIsOnTop);
+   const int32 index = this->jengaBlocks.IndexOf(block);
+   return index != INDEX_NONE && this->layers.IsOnTop(index);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Finds the blocks touching the floor in the default configuration
+void UJengaTowerSession::FindBlocksOnFloor()
+{
+   for (int32 i = 0; i < this->jengaBlocks.Num(); i++)
+      this->blockStates.Set(i, FJengaBlockStates::ON_FLOOR, FMath::Abs(this->defaultConfiguration[i].GetLocation().Z) < BLOCKS_ON_FLOOR_TOLERANCE);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the blocks that can be picked
+void UJengaTowerSession::GetInteractiveBlocks(TArray<AActor*>& outBlocks)
+{
+   outBlocks.Reset();
+   for (TConstSetBitIterator<> it(this->blockStates.GetAll(FJengaBlockStates::INTERACTIVE)); it; ++it)
+      outBlocks.Add(this->jengaBlocks.GetBlock(it.GetIndex()));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Can this block be picked?
+bool UJengaTowerSession::IsInteractive(const AActor* jengaBlock) const
+{
+   return this->blockStates.Get(this->jengaBlocks.IndexOf(jengaBlock), FJengaBlockStates::INTERACTIVE);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns where the center of a block should be put to be on top of the tower
+FVector UJengaTowerSession::GetTopPlacement()
+{
+   RefreshLayers();
+
+   float topZ = BLOCK_SIZES.Z / 2.f;
+   const TArray<int32>& topBlocks = this->layers.GetLayerBlocks(this->layers.GetTopLayer());
+   for (const int32 index : topBlocks)
+      topZ = FMath::Max(topZ, this->jengaBlocks.GetMesh(index)->Bounds.Origin.Z);
+
+   // Just a little above the top layer, so that the block falls gently
+   return FVector(this->towerCenter.X, this->towerCenter.Y, topZ + BLOCK_SIZES.Z + 1.f);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the sizes of a jenga block
+const FVector& UJengaTowerSession::GetBlockSizes()
+{
+   return BLOCK_SIZES;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Times the game logic run at every turn (snapshot, apply, interactivity refresh, stability check, undo)
+FJengaTurnCosts UJengaTowerSession::MeasureTurnCosts(int32 iterations)
+{
+   FJengaTurnCosts costs = { 0.0, 0.0, 0.0, 0.0, 0.0 };
+   iterations = FMath::Max(1, iterations);
+
+   for (int32 i = 0; i < iterations; i++)
+   {
+      double start = FPlatformTime::Seconds();
+      const TowerConfiguration towerConf = GetActualTowerConfiguration();
+      costs.snapshotMs += FPlatformTime::Seconds() - start;
+
+      // Applying a configuration that is not at rest wakes every block up: the worst case for the next steps
+      start = FPlatformTime::Seconds();
+      ApplyTowerConfiguration(towerConf, false);
+      costs.applyMs += FPlatformTime::Seconds() - start;
+
+      start = FPlatformTime::Seconds();
+      RefreshInteractivity();
+      costs.interactivityMs += FPlatformTime::Seconds() - start;
+
+      start = FPlatformTime::Seconds();
+      this->stability.Update(1.f / 60.f);
+      this->stability.IsSettled();
+      costs.stabilityMs += FPlatformTime::Seconds() - start;
+
+      // Undo of a single move, on a tower at rest: the moved block is the only one teleported
+      ApplyTowerConfiguration(towerConf, true);
+      this->jengaBlocks.GetBlock(i % this->jengaBlocks.Num())->AddActorWorldOffset(FVector(0.f, 0.f, BLOCK_SIZES.Z), false, nullptr, ETeleportType::TeleportPhysics);
+      start = FPlatformTime::Seconds();
+      ApplyTowerConfiguration(towerConf, true);
+      costs.undoMs += FPlatformTime::Seconds() - start;
+   }
+
+   costs.snapshotMs *= 1000.0 / iterations;
+   costs.applyMs *= 1000.0 / iterations;
+   costs.interactivityMs *= 1000.0 / iterations;
+   costs.stabilityMs *= 1000.0 / iterations;
+   costs.undoMs *= 1000.0 / iterations;
+   return costs;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Updates the layer of the blocks that may have moved
+void UJengaTowerSession::RefreshLayers()
+{
+   TArray<int32> movedBlocks;
+   this->stability.ConsumeWokenBlocks(movedBlocks);
+   JENGA_INC_COUNTER(STAT_JengaBlocksScanned, movedBlocks.Num());
+   for (const int32 index : movedBlocks)
+   {
+      this->layers.Update(index, this->jengaBlocks.GetBlock(index)->GetActorLocation().Z);
+      this->freezer.OnMoved(index);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Makes all blocks interactive, except the top ones
+void UJengaTowerSession::RefreshInteractivity()
+{
+   RefreshLayers();
+
+   // Only the top layer's blocks are touched, the rest is set a word at a time
+   this->blockStates.SetAll(FJengaBlockStates::TOP_LAYER, false);
+   for (const int32 index : this->layers.GetLayerBlocks(this->layers.GetTopLayer()))
+      this->blockStates.Set(index, FJengaBlockStates::TOP_LAYER, true);
+   this->blockStates.SetAllInverse(FJengaBlockStates::INTERACTIVE, FJengaBlockStates::TOP_LAYER);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns the actual tower configuration
+TowerConfiguration UJengaTowerSession::GetActualTowerConfiguration()
+{
+   JENGA_SCOPE_CYCLE_COUNTER(STAT_JengaGetConfiguration);
+   JENGA_INC_COUNTER(STAT_JengaBlocksScanned, this->jengaBlocks.Num());
+   JENGA_INC_COUNTER(STAT_JengaSnapshots, 1);
+   FJengaPerfScope perfScope(this->perfCounters, FJengaPerfCounters::SNAPSHOT);
+   return this->jengaBlocks.GetConfiguration();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Applies a given tower configuration
+void UJengaTowerSession::ApplyTowerConfiguration(const TowerConfiguration& towerConf, bool atRest)
+{
+   JENGA_SCOPE_CYCLE_COUNTER(STAT_JengaApplyConfiguration);
+   JENGA_INC_COUNTER(STAT_JengaBlocksScanned, this->jengaBlocks.Num());
+   FJengaPerfScope perfScope(this->perfCounters, FJengaPerfCounters::APPLY);
+   TGuardValue<bool> applying(this->applyingConfiguration, true);
+   this->freezer.UnfreezeFrom(this->jengaBlocks, this->layers, 0);
+   this->jengaBlocks.ApplyConfiguration(towerConf, atRest);
+   this->stability.Sync();
+   this->freezer.OnRestored();
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Shows a message to the player (if this is the tower the player sees)
+void UJengaTowerSession::ShowMessage(const FColor& color, const FString& msg)
+{
+   if (this->showMessages)
+      GEngine->AddOnScreenDebugMessage(-1, 5.f, color, msg);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// One of this tower's blocks started touching the floor
+void UJengaTowerSession::OnFloorContact(AActor* otherActor)
+{
+   const int32 index = this->jengaBlocks.IndexOf(otherActor);
+   if (this->applyingConfiguration)
+   {
+      this->blockStates.Set(index, FJengaBlockStates::ON_FLOOR, true);
+      return;
+   }
+
+   // Ignore blocks already on floor
+   if (this->blockStates.Get(index, FJengaBlockStates::ON_FLOOR) || (otherActor == pickedJengaBlock && holdingPickedJengaBlock))
+      return;
+
+   // Only the hit that collapses the tower is logged (fallen blocks keep hitting the floor)
+   if (this->towerStatus != TowerStatus::COLLAPSED)
+   {
+      LogEvent(FJengaGameEvent::FLOOR_HIT, index);
+      this->towerStatus = TowerStatus::COLLAPSED;
+      GameOver(TEXT("Tower collapsed!"));
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A block's rigid body woke up
+void UJengaTowerSession::OnBlockWake(UPrimitiveComponent* wakingComponent, FName boneName)
+{
+   this->stability.OnWake(this->jengaBlocks.IndexOf(wakingComponent->GetOwner()));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A block's rigid body fell asleep
+void UJengaTowerSession::OnBlockSleep(UPrimitiveComponent* sleepingComponent, FName boneName)
+{
+   this->stability.OnSleep(this->jengaBlocks.IndexOf(sleepingComponent->GetOwner()));
+}
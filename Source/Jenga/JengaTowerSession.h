@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "JengaBlockRegistry.h"
+#include "JengaTowerHistory.h"
+#include "JengaStabilityTracker.h"
+#include "JengaStabilityAnalyzer.h"
+#include "JengaLoadAnalyzer.h"
+#include "JengaLayerIndex.h"
+#include "JengaLayerFreezer.h"
+#include "JengaBlockStates.h"
+#include "JengaEventLog.h"
+#include "JengaTowerSession.generated.h"
+
+class AActor;
+class UPrimitiveComponent;
+class UMaterialInterface;
+class UMaterialInstanceDynamic;
+class FJengaReplayRecorder;
+class FJengaPerfCounters;
+class FJengaHashTrace;
+struct FJengaSavedGame;
+
+// Average cost (in milliseconds) of the game logic run at every turn
+struct FJengaTurnCosts
+{
+   double snapshotMs, applyMs, interactivityMs, stabilityMs;
+
+   // Restore of a tower at rest after a single move (what undo/redo cost)
+   double undoMs;
+};
+
+/**
+* A single Jenga game: the blocks of one tower, its undo/redo history, its
+* stability state and its turns. The game mode can host many of them at once.
+*/
+UCLASS()
+class JENGA_API UJengaTowerSession : public UObject
+{
+   GENERATED_BODY()
+
+public:
+   // Constructor
+   UJengaTowerSession();
+
+   // Takes ownership of a tower's blocks
+   void Init(const TArray<AActor*>& blocks, int32 historyChunkBlocks, int64 historyBudgetBytes, bool showMessages);
+
+   // Starts a new game (its blocks are randomized from the given seed)
+   void NewGame(int nPlayers, int32 seed);
+
+   void NewPick(AActor* jengaBlock, const FVector& grabPoint);
+   void DragUpdated(AActor* jengaBlock, const FVector& target);
+   void PickReleased(AActor* jengaBlock);
+
+   void Undo();
+   void Redo();
+
+   // Replays the current turn as it was played on another branch of the history
+   void SwitchBranch(int32 branch);
+
+   // Jumps to a given turn and tower configuration (used by replays)
+   void RestoreTurn(int turn, const TowerConfiguration& towerConf);
+
+   // Exports/restores the whole game (configurations, history, turn, players)
+   void SaveGame(FJengaSavedGame& outGame);
+   bool LoadGame(const FJengaSavedGame& game);
+
+   // Records every event of this tower's games (nullptr to stop)
+   void SetRecorder(FJengaReplayRecorder* recorder) { this->recorder = recorder; }
+
+   // Times turns, snapshots and restores of this tower (nullptr to stop)
+   void SetPerfCounters(FJengaPerfCounters* perfCounters) { this->perfCounters = perfCounters; }
+
+   // Logs this tower's game events, tagged with its index (nullptr to stop)
+   void SetEventLog(FJengaEventLog* eventLog, int32 towerIndex) { this->eventLog = eventLog; this->towerIndex = towerIndex; }
+
+   // Traces this tower's state hash at every turn, tagged with its index (nullptr to stop)
+   void SetHashTrace(FJengaHashTrace* hashTrace, int32 towerIndex) { this->hashTrace = hashTrace; this->towerIndex = towerIndex; }
+
+   // Called every frame by the game mode
+   void Tick(float deltaTime);
+
+   // Turns the settled bottom layers into kinematic bodies (for tall towers)
+   void SetLayerFreezing(bool enabled);
+
+   // Analyzes the tower in the background at every turn, and tints the risky blocks
+   void SetLoadHeatmap(bool enabled);
+   bool IsLoadHeatmapShown() const { return loadHeatmap; }
+   const TArray<FJengaBlockLoad>& GetBlockLoads() const { return loadAnalyzer.GetLoads(); }
+
+   // Has nobody played this tower for a while? (its blocks are then put to sleep)
+   bool IsIdle() const;
+
+   // One of this tower's blocks started touching the floor
+   void OnFloorContact(AActor* jengaBlock);
+
+   // Does this block belong to this tower?
+   bool Owns(const AActor* jengaBlock) const { return jengaBlocks.IndexOf(jengaBlock) != INDEX_NONE; }
+   const TArray<AActor*>& GetBlocks() const { return jengaBlocks.GetBlocks(); }
+   const FJengaBlockRegistry& GetBlockRegistry() const { return jengaBlocks; }
+
+   // Memory used by the undo/redo history
+   int64 GetHistoryMemoryUsage() const { return history.GetMemoryUsage(); }
+
+   // Game state queries (used by scripted players)
+   int GetTurn() const { return turn; }
+   int GetNumberOfPlayers() const { return nPlayers; }
+   int GetCurrentPlayer() { return CurrentPlayer(); }
+   bool IsWaitingForPick() const { return !pickedJengaBlock && towerStatus != TowerStatus::COLLAPSED; }
+   int32 GetSeed() const { return seed; }
+
+   // Order-independent hash of the blocks' quantized transforms, turn, player and status (see FJengaStateHash)
+   uint64 ComputeStateHash();
+   uint64 GetTurnHash() const { return turnHash; }
+   bool IsGameOver() const { return towerStatus == TowerStatus::COLLAPSED; }
+   AActor* GetPickedBlock() const { return pickedJengaBlock; }
+   const TArray<int32>& GetAwakeBlocks() const { return stability.GetAwakeBlocks(); }
+   const FVector& GetTowerCenter() const { return towerCenter; }
+   void GetInteractiveBlocks(TArray<AActor*>& outBlocks);
+   bool IsInteractive(const AActor* jengaBlock) const;
+   const FJengaBlockStates& GetBlockStates() const { return blockStates; }
+   FVector GetTopPlacement();
+   void GetBlockPoses(TArray<FTransform>& outPoses) const;
+   const FJengaStabilityAnalyzer& GetStabilityAnalyzer() const { return stabilityAnalyzer; }
+   static const FVector& GetBlockSizes();
+
+   // Times the game logic run at every turn (used by the scaling benchmark)
+   FJengaTurnCosts MeasureTurnCosts(int32 iterations);
+
+protected:
+   void NextRound();
+   void GameOver(const TCHAR* msg);
+   void LogEvent(FJengaGameEvent::Type type, int32 block = INDEX_NONE, uint64 hash = 0);
+   int CurrentPlayer();
+   bool IsOnTop(AActor* jengaBlock);
+   void RefreshLayers();
+   void RefreshInteractivity();
+   FJengaStabilityAnalyzer::Prediction PredictStability();
+   void TryNextRound();
+   void FindBlocksOnFloor();
+   void PutBlocksToSleep();
+   void UnfreezeAroundAwakeBlocks();
+   void RequestLoadAnalysis();
+   void ApplyLoadHeatmap();
+   void SetHeatLevel(int32 index, int32 level);
+
+   TowerConfiguration GetActualTowerConfiguration();
+   void ApplyTowerConfiguration(const TowerConfiguration& towerConf, bool atRest);
+
+   void ShowMessage(const FColor& color, const FString& msg);
+
+   UFUNCTION() void OnBlockWake(UPrimitiveComponent* wakingComponent, FName boneName);
+   UFUNCTION() void OnBlockSleep(UPrimitiveComponent* sleepingComponent, FName boneName);
+
+private:
+   FJengaBlockRegistry jengaBlocks;
+   TowerConfiguration defaultConfiguration, gameConfiguration;
+   FVector towerCenter;
+   FJengaTowerHistory history;
+
+   int turn, moves;
+   int nPlayers;
+
+   // Game randomness comes only from here, so that a game can be replayed from its seed
+   int32 seed;
+   FRandomStream random;
+   FJengaBlockStates blockStates;
+
+   FJengaStabilityTracker stability;
+   FJengaStabilityAnalyzer stabilityAnalyzer;
+   TArray<FTransform> blockPoses;
+   FJengaLayerIndex layers;
+   FJengaLayerFreezer freezer;
+   bool freezeLayers;
+
+   // Declared after the stability analyzer it uses, so that its worker is done before that goes away
+   FJengaLoadAnalyzer loadAnalyzer;
+   bool loadHeatmap;
+
+   // Heatmap tints (one per risk level), the blocks' own materials and their current risk levels
+   UPROPERTY() UMaterialInterface* heatmapBaseMaterial;
+   UPROPERTY() TArray<UMaterialInstanceDynamic*> heatmapMaterials;
+   UPROPERTY() TArray<UMaterialInterface*> blockMaterials;
+   TArray<int32> heatLevels;
+
+   AActor* pickedJengaBlock;
+   bool holdingPickedJengaBlock;
+   enum TowerStatus { BALANCED, MOVING, COLLAPSED };
+   TowerStatus towerStatus;
+
+   // Time since the last pick (or since the last turn ended)
+   float idleTime;
+
+   // For how long the released block has been at rest (predictions wait for it)
+   float releasedRestTime;
+
+   // Only one tower should talk to the player
+   bool showMessages;
+
+   // Blocks put on the floor by a restored configuration are resting there, not falling
+   bool applyingConfiguration;
+
+   FJengaReplayRecorder* recorder;
+   FJengaPerfCounters* perfCounters;
+   double releaseSeconds;
+   FJengaEventLog* eventLog;
+   int32 towerIndex;
+   FJengaHashTrace* hashTrace;
+
+   // State hash at the beginning of the current turn
+   uint64 turnHash;
+};
@@ -0,0 +1,217 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "JengaTowerState.h"
+#include "Jenga.h"
+#include "JengaTowerSession.h"
+
+#include "EngineGlobals.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+#include "Runtime/Engine/Classes/Engine/Engine.h"
+#include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
+
+
+static const FName JENGA_BLOCK_TAG = "JengaBlock";
+
+// Replication rate while the tower moves, and while it's at rest
+static const float MOVING_NET_UPDATE_FREQUENCY = 60.f;
+static const float RESTING_NET_UPDATE_FREQUENCY = 2.f;
+
+
+///////////////////////////////////////////////////////////////////////////
+// Bit-packed block transform
+bool FJengaReplicatedBlock::NetSerialize(FArchive& ar, class UPackageMap* map, bool& outSuccess)
+{
+   uint32 packedIndex = (uint32)this->index;
+   ar.SerializeIntPacked(packedIndex);
+   this->index = (int32)packedIndex;
+   this->transform.NetSerialize(ar);
+
+   outSuccess = !ar.IsError();
+   return true;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A block was received for the first time
+void FJengaReplicatedBlock::PostReplicatedAdd(const FJengaReplicatedBlocks& blocks)
+{
+   if (blocks.owner)
+      blocks.owner->ApplyBlockTransform(this->index, this->transform);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A block moved
+void FJengaReplicatedBlock::PostReplicatedChange(const FJengaReplicatedBlocks& blocks)
+{
+   if (blocks.owner)
+      blocks.owner->ApplyBlockTransform(this->index, this->transform);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Constructor
+AJengaTowerState::AJengaTowerState()
+{
+   turn = -1;
+   currentPlayer = 0;
+   nPlayers = 1;
+   gameOver = false;
+   towerMoving = false;
+   pickedBlock = INDEX_NONE;
+   highlightedBlock = INDEX_NONE;
+   shownTurn = -1;
+   blocks.owner = this;
+   session = nullptr;
+   offset = FVector::ZeroVector;
+
+   bReplicates = true;
+   bAlwaysRelevant = false;
+   NetUpdateFrequency = MOVING_NET_UPDATE_FREQUENCY;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sets the replicated tower
+void AJengaTowerState::Init(UJengaTowerSession* session, const FVector& offset)
+{
+   this->session = session;
+   this->offset = offset;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Only the match's players receive its tower
+bool AJengaTowerState::IsNetRelevantFor(const AActor* realViewer, const AActor* viewTarget, const FVector& srcLocation) const
+{
+   return this->players.Contains(realViewer);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Called when the game starts or when spawned
+void AJengaTowerState::BeginPlay()
+{
+   Super::BeginPlay();
+
+   // Clients don't simulate: the blocks are moved by the server
+   if (!HasAuthority())
+   {
+      this->jengaBlocks.Register(GetWorld(), JENGA_BLOCK_TAG);
+      for (int32 i = 0; i < this->jengaBlocks.Num(); i++)
+         this->jengaBlocks.GetMesh(i)->SetSimulatePhysics(false);
+
+      // Blocks received before the level was ready
+      for (const auto& block : this->blocks.items)
+         ApplyBlockTransform(block.index, block.transform);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Replicated properties
+void AJengaTowerState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& outLifetimeProps) const
+{
+   Super::GetLifetimeReplicatedProps(outLifetimeProps);
+
+   DOREPLIFETIME(AJengaTowerState, blocks);
+   DOREPLIFETIME(AJengaTowerState, turn);
+   DOREPLIFETIME(AJengaTowerState, currentPlayer);
+   DOREPLIFETIME(AJengaTowerState, nPlayers);
+   DOREPLIFETIME(AJengaTowerState, gameOver);
+   DOREPLIFETIME(AJengaTowerState, towerMoving);
+   DOREPLIFETIME(AJengaTowerState, pickedBlock);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Copies the state of the tower
+void AJengaTowerState::Update()
+{
+   const FJengaBlockRegistry& registry = this->session->GetBlockRegistry();
+
+   // First update: every block is sent once
+   if (this->blocks.items.Num() != registry.Num())
+   {
+      this->blocks.items.SetNum(registry.Num());
+      for (int32 i = 0; i < registry.Num(); i++)
+      {
+         this->blocks.items[i].index = i;
+         this->blocks.items[i].transform = FJengaQuantizedTransform(GetLevelTransform(registry, i));
+         this->blocks.MarkItemDirty(this->blocks.items[i]);
+      }
+   }
+
+   // Sleeping blocks can't move: only the awake ones are checked
+   const TArray<int32>& awakeBlocks = this->session->GetAwakeBlocks();
+   for (const int32 index : awakeBlocks)
+      UpdateBlock(registry, index);
+
+   // The tower just stopped: send where each block came to rest
+   const bool moving = awakeBlocks.Num() > 0;
+   if (!moving && this->towerMoving)
+      for (int32 i = 0; i < registry.Num(); i++)
+         UpdateBlock(registry, i);
+   this->towerMoving = moving;
+   this->NetUpdateFrequency = moving ? MOVING_NET_UPDATE_FREQUENCY : RESTING_NET_UPDATE_FREQUENCY;
+
+   this->turn = this->session->GetTurn();
+   this->currentPlayer = this->session->GetCurrentPlayer();
+   this->nPlayers = this->session->GetNumberOfPlayers();
+   this->gameOver = this->session->IsGameOver();
+   this->pickedBlock = registry.IndexOf(this->session->GetPickedBlock());
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Sends a block if it moved by at least one quantization step
+void AJengaTowerState::UpdateBlock(const FJengaBlockRegistry& registry, int32 index)
+{
+   const FJengaQuantizedTransform transform(GetLevelTransform(registry, index));
+   FJengaReplicatedBlock& block = this->blocks.items[index];
+   if (block.transform != transform)
+   {
+      block.transform = transform;
+      this->blocks.MarkItemDirty(block);
+   }
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Returns a block's transform as if its tower stood in place of the level's one
+FTransform AJengaTowerState::GetLevelTransform(const FJengaBlockRegistry& registry, int32 index) const
+{
+   FTransform trx = registry.GetBlock(index)->GetActorTransform();
+   trx.AddToTranslation(-this->offset);
+   return trx;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Moves a block to its replicated transform
+void AJengaTowerState::ApplyBlockTransform(int32 index, const FJengaQuantizedTransform& transform)
+{
+   if (index < 0 || index >= this->jengaBlocks.Num())
+      return;
+
+   const FTransform trx = transform.ToTransform();
+   this->jengaBlocks.GetBlock(index)->SetActorLocationAndRotation(trx.GetLocation(), trx.GetRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// A new turn started (client side)
+void AJengaTowerState::OnRep_Turn()
+{
+   if (this->turn == this->shownTurn)
+      return;
+   this->shownTurn = this->turn;
+
+   FString debugStr = "Turn " + FString::FromInt(this->turn + 1);
+   if (this->nPlayers > 1)
+      debugStr += ": Player " + FString::FromInt(this->currentPlayer + 1) + " moves!";
+   GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, debugStr);
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Highlights the picked block (client side)
+void AJengaTowerState::OnRep_PickedBlock()
+{
+   if (this->jengaBlocks.Num() == 0)
+      return;
+
+   if (this->highlightedBlock != INDEX_NONE)
+      this->jengaBlocks.GetMesh(this->highlightedBlock)->SetRenderCustomDepth(false);
+   this->highlightedBlock = this->pickedBlock;
+   if (this->highlightedBlock != INDEX_NONE)
+      this->jengaBlocks.GetMesh(this->highlightedBlock)->SetRenderCustomDepth(true);
+}
@@ -0,0 +1,133 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "Engine/NetSerialization.h"
+#include "JengaBlockRegistry.h"
+#include "JengaQuantization.h"
+#include "JengaTowerState.generated.h"
+
+class AJengaTowerState;
+class UJengaTowerSession;
+struct FJengaReplicatedBlocks;
+
+// The quantized transform of a block, sent to clients when it changes
+USTRUCT()
+struct FJengaReplicatedBlock : public FFastArraySerializerItem
+{
+   GENERATED_BODY()
+
+   int32 index;
+   FJengaQuantizedTransform transform;
+
+   FJengaReplicatedBlock() : index(INDEX_NONE) {}
+
+   bool NetSerialize(FArchive& ar, class UPackageMap* map, bool& outSuccess);
+
+   // Client side: moves the block
+   void PostReplicatedAdd(const FJengaReplicatedBlocks& blocks);
+   void PostReplicatedChange(const FJengaReplicatedBlocks& blocks);
+};
+
+template<>
+struct TStructOpsTypeTraits<FJengaReplicatedBlock> : public TStructOpsTypeTraitsBase2<FJengaReplicatedBlock>
+{
+   enum { WithNetSerializer = true };
+};
+
+// All the blocks of the player's tower: only the changed ones are sent
+USTRUCT()
+struct FJengaReplicatedBlocks : public FFastArraySerializer
+{
+   GENERATED_BODY()
+
+   UPROPERTY() TArray<FJengaReplicatedBlock> items;
+   AJengaTowerState* owner;
+
+   FJengaReplicatedBlocks() : owner(nullptr) {}
+
+   bool NetDeltaSerialize(FNetDeltaSerializeInfo& deltaParms)
+   {
+      return FFastArraySerializer::FastArrayDeltaSerialize<FJengaReplicatedBlock, FJengaReplicatedBlocks>(items, deltaParms, *this);
+   }
+};
+
+template<>
+struct TStructOpsTypeTraits<FJengaReplicatedBlocks> : public TStructOpsTypeTraitsBase2<FJengaReplicatedBlocks>
+{
+   enum { WithNetDeltaSerializer = true };
+};
+
+/**
+* What the players of a match know about its tower: turn state and block transforms.
+* The server is the only one simulating physics: block transforms are quantized and
+* only the awake blocks that moved by at least one quantization step are sent, so a
+* tower at rest costs no bandwidth. Only the match's players receive it, and they see
+* it in place of the level's tower.
+*/
+UCLASS()
+class JENGA_API AJengaTowerState : public AInfo
+{
+   GENERATED_BODY()
+
+public:
+   // Constructor
+   AJengaTowerState();
+
+   // Server side: sets the replicated tower, and how far it is from the level's one
+   void Init(UJengaTowerSession* session, const FVector& offset);
+   UJengaTowerSession* GetSession() const { return session; }
+   const FVector& GetOffset() const { return offset; }
+
+   // Server side: the players receiving this tower
+   void AddPlayer(const AActor* player) { players.AddUnique(player); }
+   void RemovePlayer(const AActor* player) { players.Remove(player); }
+   int32 GetNumPlayers() const { return players.Num(); }
+
+   // Server side: copies the state of the tower (called every frame)
+   void Update();
+
+   // Client side: moves a block to its replicated transform
+   void ApplyBlockTransform(int32 index, const FJengaQuantizedTransform& transform);
+
+   // Turn state
+   int GetTurn() const { return turn; }
+   int GetCurrentPlayer() const { return currentPlayer; }
+   int GetNumberOfPlayers() const { return nPlayers; }
+   bool IsGameOver() const { return gameOver; }
+   bool IsTowerMoving() const { return towerMoving; }
+
+   virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& outLifetimeProps) const override;
+   virtual bool IsNetRelevantFor(const AActor* realViewer, const AActor* viewTarget, const FVector& srcLocation) const override;
+
+protected:
+   // Called when the game starts or when spawned
+   virtual void BeginPlay() override;
+
+   UFUNCTION() void OnRep_Turn();
+   UFUNCTION() void OnRep_PickedBlock();
+
+private:
+   void UpdateBlock(const FJengaBlockRegistry& registry, int32 index);
+   FTransform GetLevelTransform(const FJengaBlockRegistry& registry, int32 index) const;
+
+   UPROPERTY(Replicated) FJengaReplicatedBlocks blocks;
+   UPROPERTY(ReplicatedUsing=OnRep_Turn) int32 turn;
+   UPROPERTY(Replicated) int32 currentPlayer;
+   UPROPERTY(Replicated) int32 nPlayers;
+   UPROPERTY(Replicated) bool gameOver;
+   UPROPERTY(Replicated) bool towerMoving;
+   UPROPERTY(ReplicatedUsing=OnRep_PickedBlock) int32 pickedBlock;
+
+   // Server side
+   UPROPERTY() UJengaTowerSession* session;
+   FVector offset;
+   TArray<const AActor*> players;
+
+   // Client side: the blocks of the level's tower (same order as on the server)
+   FJengaBlockRegistry jengaBlocks;
+   int32 highlightedBlock;
+   int32 shownTurn;
+};